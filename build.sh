@@ -5,8 +5,54 @@ set -e
 NAME="mayan-swap"
 SONAME="mayanswap"
 VERSION="v0.2"
+PROFILE="${PROFILE:-debug}"
+
+if [[ "$PROFILE" == "release" ]]; then
+	PROFILE_DEF="#define BUILD_RELEASE"
+elif [[ "$PROFILE" != "debug" ]]; then
+	echo "unknown PROFILE: $PROFILE (debug|release)"
+	exit 1
+fi
 
 BUILD_FILE="./src/program-c/src/$SONAME/build-info.h"
+KEYPAIR="./dist/program/$SONAME-keypair.json"
+
+# base58 pubkey -> 32 comma separated bytes
+b58_bytes() {
+	local alpha="123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz"
+	local n=0 c rest hex
+
+	for ((i = 0; i < ${#1}; i++)); do
+		c="${1:i:1}"
+		rest="${alpha%%"$c"*}"
+		n=`echo "$n*58+${#rest}" | BC_LINE_LENGTH=0 bc`
+	done
+
+	hex=`echo "obase=16; $n" | BC_LINE_LENGTH=0 bc`
+	hex=`printf "%64s" $hex | tr ' ' 0`
+	echo $hex | sed 's/../0x&, /g; s/, $//'
+}
+
+# the MAIN authority is the same PDA for every order, derive it once here
+if [[ -z "$PROGRAM_ID" && -f "$KEYPAIR" ]]; then
+	PROGRAM_ID=`solana-keygen pubkey $KEYPAIR`
+fi
+
+if [[ -n "$PROGRAM_ID" ]]; then
+	# {"address": "...", "bumpSeed": n}, one line or pretty printed
+	MAIN_JSON=`solana find-program-derived-address $PROGRAM_ID string:MAIN --output json`
+	MAIN_ADDR=`echo "$MAIN_JSON" | sed -n 's/.*"address": *"\([^"]*\)".*/\1/p'`
+	MAIN_NONCE=`echo "$MAIN_JSON" | sed -n 's/.*"bumpSeed": *\([0-9]*\).*/\1/p'`
+	if [[ -z "$MAIN_ADDR" || -z "$MAIN_NONCE" ]]; then
+		echo "cannot derive MAIN of $PROGRAM_ID: $MAIN_JSON"
+		exit 1
+	fi
+	MAIN_DEF="#define BUILD_PROGRAM_ID \"$PROGRAM_ID\"
+#define BUILD_MAIN_KEY {`b58_bytes $MAIN_ADDR`}
+#define BUILD_MAIN_NONCE $MAIN_NONCE"
+else
+	echo "no PROGRAM_ID or $KEYPAIR, MAIN is derived at runtime"
+fi
 
 COUNTER=`echo $(cat ./b_counter)+1 | bc`
 echo $COUNTER > ./b_counter
@@ -21,7 +67,10 @@ echo """
 #define BUILD_VER $VERSION
 #define BUILD_COUNTER $COUNTER
 #define BUILD_TIME $TIME
-#define BUILD_TEXT \"$NAME $VERSION (build $COUNTER at $TIME)\"
+#define BUILD_PROFILE $PROFILE
+#define BUILD_TEXT \"$NAME $VERSION $PROFILE (build $COUNTER at $TIME)\"
+$PROFILE_DEF
+$MAIN_DEF
 
 #endif //_BUILD_INFO_H_
 """ > $BUILD_FILE
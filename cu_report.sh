@@ -0,0 +1,40 @@
+#!/bin/bash
+# builds the debug and release profiles and compares syscall CU per
+# instruction (host runner) and .so size.
+#
+# usage: ./cu_report.sh input...
+
+set -e
+
+SONAME="mayanswap"
+OUT=$(mktemp -d)
+
+if [[ $# -eq 0 ]]; then
+	echo "usage: $0 input..."
+	exit 1
+fi
+
+for PROFILE in debug release; do
+	PROFILE=$PROFILE ./build.sh > /dev/null
+	cp dist/program/$SONAME.so $OUT/$PROFILE.so
+
+	make -C ./src/program-c mayanswap-host > /dev/null
+	./dist/host/mayanswap-host -q "$@" > $OUT/$PROFILE.txt
+done
+
+echo "ix    debug  release    delta"
+awk 'NR == FNR && $1 ~ /^[0-9]+$/ { dbg[$1] = $5; next }
+     $1 ~ /^[0-9]+$/ {
+	printf "%-4s %7d %8d %8d (%.1f%%)\n", $1, dbg[$1], $5, $5 - dbg[$1],
+	       dbg[$1] ? 100 * ($5 - dbg[$1]) / dbg[$1] : 0
+     }' $OUT/debug.txt $OUT/release.txt
+
+DBG_SIZE=$(stat -c %s $OUT/debug.so)
+REL_SIZE=$(stat -c %s $OUT/release.so)
+echo
+echo ".so  $DBG_SIZE -> $REL_SIZE ($((REL_SIZE - DBG_SIZE)) bytes)"
+
+rm -r $OUT
+
+# leave the tree on the default profile
+./build.sh > /dev/null
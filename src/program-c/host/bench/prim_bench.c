@@ -0,0 +1,123 @@
+/*
+  host microbenchmark of the byte primitives in bytes.h against the byte
+  loops they replaced. x86 timings only say the new code is not worse;
+  the on-chain numbers come from the CU meter of a bpf build.
+
+    make -C src/program-c mayanswap-prim-bench && ./dist/host/mayanswap-prim-bench
+ */
+#include <stdio.h>
+#include <time.h>
+
+#include "utils.h"
+
+#define ROUNDS 20000000
+#define SLOTS 64
+
+static u8 bufs[SLOTS][40];
+
+static u64 ref_read_u64_be(const u8 *data)
+{
+	u64 result = 0;
+	for (int i = 0; i < 8; ++i) {
+		result *= 256;
+		result += *data;
+		++data;
+	}
+	return result;
+}
+
+static void ref_write_u64_be(u8 *buffer, u64 x)
+{
+	buffer += 7;
+	for (int i = 0; i < 8; ++i) {
+		*buffer = x % 256;
+		x /= 256;
+		buffer--;
+	}
+}
+
+static bool ref_buf_pubkey_same(const u8 *data, const SolPubkey *key)
+{
+	const u8 *ref = key->x;
+
+	for (int i = 0; i < 32; ++i) {
+		if (*ref != *data)
+			return false;
+		ref++;
+		data++;
+	}
+	return true;
+}
+
+static void ref_write_buffer(u8 **data_ptr, const u8 *buf, int size)
+{
+	for (int i = 0; i < size; ++i) {
+		**data_ptr = *buf;
+		(*data_ptr)++;
+		buf++;
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// volatile sink, keeps the loops from being folded
+static volatile u64 sink;
+
+#define BENCH(name, body)                                                      \
+	do {                                                                   \
+		u64 acc = 0;                                                   \
+		double t = now();                                              \
+		for (u64 r = 0; r < ROUNDS; ++r) {                             \
+			u8 *p = bufs[r % SLOTS];                               \
+			u8 *q = bufs[(r + 1) % SLOTS];                         \
+			(void)q;                                               \
+			body;                                                  \
+		}                                                              \
+		t = now() - t;                                                 \
+		sink = acc;                                                    \
+		printf("%-24s %6.2f ns\n", name, t * 1e9 / ROUNDS);            \
+	} while (0)
+
+int main(void)
+{
+	for (int i = 0; i < SLOTS; ++i)
+		for (int j = 0; j < 40; ++j)
+			bufs[i][j] = (u8)(i * 7 + j);
+
+	// equal keys, the compare has to look at all 32 bytes
+	for (int i = 0; i < SLOTS; i += 2)
+		for (int j = 0; j < 40; ++j)
+			bufs[i + 1][j] = bufs[i][j];
+
+	for (int i = 0; i < SLOTS; ++i) {
+		u64 x = ref_read_u64_be(bufs[i]);
+		u8 a[8], b[8];
+
+		ref_write_u64_be(a, x);
+		write_u64_be(b, x);
+		if (read_u64_be(bufs[i]) != x || *(u64 *)a != *(u64 *)b ||
+		    buf_pubkey_same(bufs[i], (SolPubkey *)bufs[i ^ 1]) !=
+			    ref_buf_pubkey_same(bufs[i], (SolPubkey *)bufs[i ^ 1])) {
+			printf("mismatch at %d\n", i);
+			return 1;
+		}
+	}
+
+	BENCH("read_u64_be (loop)", acc += ref_read_u64_be(p));
+	BENCH("read_u64_be", acc += read_u64_be(p));
+	BENCH("write_u64_be (loop)", ref_write_u64_be(p, r); acc += p[0]);
+	BENCH("write_u64_be", write_u64_be(p, r); acc += p[0]);
+	BENCH("buf_pubkey_same (loop)",
+	      acc += ref_buf_pubkey_same(p, (SolPubkey *)q));
+	BENCH("buf_pubkey_same", acc += buf_pubkey_same(p, (SolPubkey *)q));
+	BENCH("write_buffer 32 (loop)", ref_write_buffer(&p, q + 8, 32); acc += p[-1]);
+	BENCH("write_buffer 32", write_buffer(p, &p, q + 8, 32); acc += p[-1]);
+
+	return 0;
+}
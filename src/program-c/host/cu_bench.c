@@ -0,0 +1,230 @@
+/*
+  host runner for mayanswap.
+
+  usage: mayanswap-host [-v | -q] input...
+
+  each input is a raw serialized program input, byte for byte what the
+  runtime hands to `entrypoint` (e.g. dumped from a validator or built by
+  the relayer). it is fed to `entrypoint()` and the syscall compute
+  units are reported per input and per instruction.
+
+  -v prints the program logs, -q prints only the per-instruction summary.
+ */
+#include "cu_meter.h"
+#include "sysvars.h"
+#include "ctx.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern u64 entrypoint(const uint8_t *input);
+
+struct ix_stat {
+	u64 runs;
+	u64 failed;
+	u64 min;
+	u64 max;
+	u64 sum;
+	struct cu_meter meter;
+};
+
+static struct ix_stat stats[256];
+
+// largest account the runtime serializes (10 MiB)
+#define INPUT_MAX_DATA_LEN (10 * 1024 * 1024)
+
+static u8 *read_input(const char *path, size_t *len)
+{
+	FILE *f;
+	u8 *buf;
+	long size;
+
+	f = fopen(path, "rb");
+	if (f == NULL)
+		return NULL;
+
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	// the program writes into account data, keep it 16 byte aligned
+	// like the runtime does
+	buf = aligned_alloc(16, (size + 15) & ~15L);
+	if (buf != NULL && fread(buf, 1, size, f) != (size_t)size) {
+		free(buf);
+		buf = NULL;
+	}
+	fclose(f);
+
+	*len = size;
+	return buf;
+}
+
+// sysvar accounts of the input are what the syscalls return
+static void input_sysvar(const u8 *key, const u8 *data, u64 data_len)
+{
+	const SolPubkey rent = RENT_VAR_KEY;
+	const SolPubkey clock = CLOCK_VAR_KEY;
+
+	if (memcmp(key, rent.x, 32) == 0 && data_len >= 17)
+		memcpy(host_sysvars.rent, data, 17);
+	if (memcmp(key, clock.x, 32) == 0 && data_len >= 40)
+		memcpy(host_sysvars.clock, data, 40);
+}
+
+// walk the serialized accounts to find the instruction data
+static bool input_instruction(const u8 *input, size_t len, u8 *instruction)
+{
+	const u8 *ptr = input;
+	const u8 *end = input + len;
+	const u8 *key;
+	u64 ka_num;
+	u64 data_len;
+
+	if (len < sizeof(u64))
+		return false;
+
+	ka_num = *(u64 *)ptr;
+	ptr += sizeof(u64);
+
+	// a dup entry takes 8 bytes, more accounts cannot fit
+	if (ka_num > (u64)(end - ptr) / 8)
+		return false;
+
+	for (u64 i = 0; i < ka_num; ++i) {
+		if (end - ptr < 8)
+			return false;
+		if (*ptr != UINT8_MAX) {
+			if (*ptr >= i)
+				return false;
+			ptr += 8;
+			continue;
+		}
+		if (end - ptr < 8 + 32 + 32 + 8 + 8)
+			return false;
+		key = ptr + 8;
+		ptr += 8 + 32 + 32 + 8;
+		data_len = *(u64 *)ptr;
+		ptr += sizeof(u64);
+		if (data_len > INPUT_MAX_DATA_LEN ||
+		    data_len + MAX_PERMITTED_DATA_INCREASE + sizeof(u64) >
+			    (u64)(end - ptr))
+			return false;
+		input_sysvar(key, ptr, data_len);
+		ptr += data_len + MAX_PERMITTED_DATA_INCREASE;
+		ptr = (const u8 *)(((u64)ptr + BPF_ALIGN_OF_U128 - 1) &
+				   ~(u64)(BPF_ALIGN_OF_U128 - 1));
+		ptr += sizeof(u64);
+		if (ptr > end)
+			return false;
+	}
+
+	if (end - ptr < 8)
+		return false;
+
+	data_len = *(u64 *)ptr;
+	ptr += sizeof(u64);
+	if (data_len < 1 || data_len + sizeof(SolPubkey) > (u64)(end - ptr))
+		return false;
+
+	*instruction = ptr[0];
+	return true;
+}
+
+static void print_meter(const struct cu_meter *meter, u64 runs)
+{
+	for (int k = 0; k < CU_KIND_NUM; ++k) {
+		if (meter->calls[k] == 0)
+			continue;
+		printf(" %s=%lu/%lu", cu_kind_name(k), meter->units[k] / runs,
+		       meter->calls[k] / runs);
+	}
+	printf("\n");
+}
+
+static void account(struct ix_stat *stat, u64 result)
+{
+	u64 total = cu_total(&cu_meter);
+
+	if (stat->runs == 0 || total < stat->min)
+		stat->min = total;
+	if (total > stat->max)
+		stat->max = total;
+
+	stat->runs++;
+	stat->sum += total;
+	if (result != SUCCESS)
+		stat->failed++;
+
+	for (int k = 0; k < CU_KIND_NUM; ++k) {
+		stat->meter.units[k] += cu_meter.units[k];
+		stat->meter.calls[k] += cu_meter.calls[k];
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int first = 1;
+	bool quiet = false;
+
+	if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+		cu_meter.verbose = 1;
+		first++;
+	} else if (argc > 1 && strcmp(argv[1], "-q") == 0) {
+		quiet = true;
+		first++;
+	}
+
+	if (first >= argc) {
+		fprintf(stderr, "usage: %s [-v | -q] input...\n", argv[0]);
+		return 2;
+	}
+
+	for (int i = first; i < argc; ++i) {
+		size_t len;
+		u8 *input;
+		u8 instruction;
+		u64 result;
+
+		input = read_input(argv[i], &len);
+		if (input == NULL) {
+			fprintf(stderr, "%s: cannot read input\n", argv[i]);
+			return 1;
+		}
+
+		host_sysvars_reset();
+		if (!input_instruction(input, len, &instruction)) {
+			fprintf(stderr, "%s: malformed input\n", argv[i]);
+			free(input);
+			return 1;
+		}
+
+		cu_meter_reset();
+		result = entrypoint(input);
+		account(&stats[instruction], result);
+
+		free(input);
+		if (quiet)
+			continue;
+
+		printf("%s: ix=%u result=%#lx cu=%lu", argv[i], instruction,
+		       result, cu_total(&cu_meter));
+		print_meter(&cu_meter, 1);
+	}
+
+	printf("%s%-4s %6s %6s %8s %8s %8s  breakdown (cu/calls per run)\n",
+	       quiet ? "" : "\n", "ix", "runs", "failed", "min", "avg", "max");
+	for (int ix = 0; ix < 256; ++ix) {
+		const struct ix_stat *stat = &stats[ix];
+
+		if (stat->runs == 0)
+			continue;
+		printf("%-4d %6lu %6lu %8lu %8lu %8lu ", ix, stat->runs,
+		       stat->failed, stat->min, stat->sum / stat->runs,
+		       stat->max);
+		print_meter(&stat->meter, stat->runs);
+	}
+
+	return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef _CU_METER_H_
+#define _CU_METER_H_
+
+#include <stdint.h>
+
+/*
+  compute unit prices of the runtime (ComputeBudget defaults).
+  only syscalls are metered on the host: bpf instructions executed
+  by the program itself and by CPI callees are not visible here.
+ */
+#define CU_SYSCALL_BASE 100
+#define CU_LOG_64 100
+#define CU_LOG_PUBKEY 100
+#define CU_CREATE_PROGRAM_ADDRESS 1500
+#define CU_INVOKE 1000
+#define CU_CPI_BYTES_PER_UNIT 250
+#define CU_MEM_OP_BASE 10
+#define CU_SYSVAR_BASE 100
+
+enum cu_kind {
+	CU_KIND_LOG,
+	CU_KIND_LOG_64,
+	CU_KIND_LOG_DATA,
+	CU_KIND_PDA,
+	CU_KIND_INVOKE,
+	CU_KIND_MEM,
+	CU_KIND_SYSVAR,
+	CU_KIND_NUM,
+};
+
+struct cu_meter {
+	uint64_t units[CU_KIND_NUM];
+	uint64_t calls[CU_KIND_NUM];
+	int verbose;
+};
+
+extern struct cu_meter cu_meter;
+
+static inline void cu_charge(enum cu_kind kind, uint64_t units)
+{
+	cu_meter.units[kind] += units;
+	cu_meter.calls[kind]++;
+}
+
+static inline uint64_t cu_total(const struct cu_meter *meter)
+{
+	uint64_t total = 0;
+
+	for (int i = 0; i < CU_KIND_NUM; ++i)
+		total += meter->units[i];
+	return total;
+}
+
+void cu_meter_reset(void);
+const char *cu_kind_name(enum cu_kind kind);
+
+#endif // _CU_METER_H_
@@ -0,0 +1,176 @@
+/*
+  ed25519 point check for the host build.
+  Only used by the mock `sol_create_program_address` to reject program
+  addresses on the curve like the runtime does, so it favours being short
+  over being fast or constant time.
+
+  a compressed point is on the curve when x^2 = (y^2 - 1) / (d y^2 + 1)
+  has a root, i.e. when `sqrt_ratio` succeeds (curve25519-dalek semantics:
+  y is not required to be canonical, the sign bit is ignored).
+ */
+#include "ed25519.h"
+#include <string.h>
+
+typedef uint64_t fe[5];
+
+#define MASK51 ((1ULL << 51) - 1)
+
+// -121665 / 121666
+static const uint8_t d_bytes[32] = {
+	0xa3, 0x78, 0x59, 0x13, 0xca, 0x4d, 0xeb, 0x75, 0xab, 0xd8, 0x41,
+	0x41, 0x4d, 0x0a, 0x70, 0x00, 0x98, 0xe8, 0x79, 0x77, 0x79, 0x40,
+	0xc7, 0x8c, 0x73, 0xfe, 0x6f, 0x2b, 0xee, 0x6c, 0x03, 0x52,
+};
+
+static uint64_t load64(const uint8_t *s)
+{
+	uint64_t x;
+
+	memcpy(&x, s, sizeof(x));
+	return x;
+}
+
+static void fe_frombytes(fe h, const uint8_t s[32])
+{
+	h[0] = load64(s) & MASK51;
+	h[1] = (load64(s + 6) >> 3) & MASK51;
+	h[2] = (load64(s + 12) >> 6) & MASK51;
+	h[3] = (load64(s + 19) >> 1) & MASK51;
+	h[4] = (load64(s + 24) >> 12) & MASK51;
+}
+
+static void fe_carry(fe h)
+{
+	uint64_t c;
+
+	for (int i = 0; i < 4; ++i) {
+		c = h[i] >> 51;
+		h[i] &= MASK51;
+		h[i + 1] += c;
+	}
+	c = h[4] >> 51;
+	h[4] &= MASK51;
+	h[0] += 19 * c;
+}
+
+static void fe_tobytes(uint8_t s[32], const fe f)
+{
+	uint64_t w[4];
+	uint64_t q;
+	fe h;
+
+	memcpy(h, f, sizeof(fe));
+	fe_carry(h);
+	fe_carry(h);
+
+	// q = 1 when h >= p
+	q = (h[0] + 19) >> 51;
+	for (int i = 1; i < 5; ++i)
+		q = (h[i] + q) >> 51;
+
+	h[0] += 19 * q;
+	fe_carry(h);
+
+	w[0] = h[0] | h[1] << 51;
+	w[1] = h[1] >> 13 | h[2] << 38;
+	w[2] = h[2] >> 26 | h[3] << 25;
+	w[3] = h[3] >> 39 | h[4] << 12;
+	memcpy(s, w, sizeof(w));
+}
+
+static void fe_add(fe h, const fe f, const fe g)
+{
+	for (int i = 0; i < 5; ++i)
+		h[i] = f[i] + g[i];
+	fe_carry(h);
+}
+
+// f + 2p - g
+static void fe_sub(fe h, const fe f, const fe g)
+{
+	h[0] = f[0] + 0xfffffffffffdaULL - g[0];
+	for (int i = 1; i < 5; ++i)
+		h[i] = f[i] + 0xffffffffffffeULL - g[i];
+	fe_carry(h);
+}
+
+static void fe_mul(fe h, const fe f, const fe g)
+{
+	unsigned __int128 t[5] = {0};
+	uint64_t c;
+
+	for (int i = 0; i < 5; ++i) {
+		for (int j = 0; j < 5; ++j) {
+			unsigned __int128 p = (unsigned __int128)f[i] * g[j];
+
+			if (i + j < 5)
+				t[i + j] += p;
+			else
+				t[i + j - 5] += p * 19;
+		}
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		t[i + 1] += t[i] >> 51;
+		h[i] = (uint64_t)t[i] & MASK51;
+	}
+	c = (uint64_t)(t[4] >> 51);
+	h[4] = (uint64_t)t[4] & MASK51;
+	h[0] += 19 * c;
+	fe_carry(h);
+}
+
+// f^((p - 5) / 8), the exponent 2^252 - 3 has every bit but bit 1 set
+static void fe_pow22523(fe h, const fe f)
+{
+	fe r = {1};
+
+	for (int bit = 251; bit >= 0; --bit) {
+		fe_mul(r, r, r);
+		if (bit != 1)
+			fe_mul(r, r, f);
+	}
+	memcpy(h, r, sizeof(fe));
+}
+
+static bool fe_equal(const fe f, const fe g)
+{
+	uint8_t a[32];
+	uint8_t b[32];
+
+	fe_tobytes(a, f);
+	fe_tobytes(b, g);
+	return memcmp(a, b, sizeof(a)) == 0;
+}
+
+bool ed25519_on_curve(const uint8_t point[32])
+{
+	const fe one = {1};
+	const fe zero = {0};
+	fe d, y, y2, u, v, v3, v7, r, check, neg_u;
+
+	fe_frombytes(d, d_bytes);
+	fe_frombytes(y, point);
+
+	fe_mul(y2, y, y);
+	fe_sub(u, y2, one);
+	fe_mul(v, d, y2);
+	fe_add(v, v, one);
+
+	// r = u v^3 (u v^7)^((p - 5) / 8)
+	fe_mul(v3, v, v);
+	fe_mul(v3, v3, v);
+	fe_mul(v7, v3, v3);
+	fe_mul(v7, v7, v);
+	fe_mul(r, u, v7);
+	fe_pow22523(r, r);
+	fe_mul(r, r, v3);
+	fe_mul(r, r, u);
+
+	// v r^2 is u or -u when u / v is a square
+	fe_mul(check, r, r);
+	fe_mul(check, check, v);
+	fe_sub(neg_u, zero, u);
+
+	return fe_equal(check, u) || fe_equal(check, neg_u);
+}
@@ -0,0 +1,9 @@
+#ifndef _HOST_ED25519_H_
+#define _HOST_ED25519_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+bool ed25519_on_curve(const uint8_t point[32]);
+
+#endif // _HOST_ED25519_H_
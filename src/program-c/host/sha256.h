@@ -0,0 +1,17 @@
+#ifndef _HOST_SHA256_H_
+#define _HOST_SHA256_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+	uint32_t state[8];
+	uint64_t count;
+	unsigned char buffer[64];
+} SHA256_CTX;
+
+void SHA256Init(SHA256_CTX *ctx);
+void SHA256Update(SHA256_CTX *ctx, const unsigned char *data, size_t len);
+void SHA256Final(unsigned char digest[32], SHA256_CTX *ctx);
+
+#endif // _HOST_SHA256_H_
@@ -0,0 +1,246 @@
+/*
+  mock `sol_*` syscall layer for the host build.
+
+  every syscall is charged at the runtime's price into `cu_meter`.
+  CPIs are not executed (the callee is not available on the host), they
+  only pay the invoke cost and succeed.
+ */
+#include "cu_meter.h"
+#include "ed25519.h"
+#include "sha256.h"
+#include "sysvars.h"
+#include "event.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+
+struct cu_meter cu_meter;
+struct host_sysvars host_sysvars;
+
+static const char *cu_kind_names[CU_KIND_NUM] = {
+	[CU_KIND_LOG] = "log",
+	[CU_KIND_LOG_64] = "log_64",
+	[CU_KIND_LOG_DATA] = "log_data",
+	[CU_KIND_PDA] = "pda",
+	[CU_KIND_INVOKE] = "invoke",
+	[CU_KIND_MEM] = "mem",
+	[CU_KIND_SYSVAR] = "sysvar",
+};
+
+void cu_meter_reset(void)
+{
+	int verbose = cu_meter.verbose;
+
+	memset(&cu_meter, 0, sizeof(cu_meter));
+	cu_meter.verbose = verbose;
+}
+
+const char *cu_kind_name(enum cu_kind kind)
+{
+	return cu_kind_names[kind];
+}
+
+void sol_log_(const char *msg, u64 len)
+{
+	cu_charge(CU_KIND_LOG, max((u64)CU_SYSCALL_BASE, len));
+	if (cu_meter.verbose)
+		printf("Program log: %.*s\n", (int)len, msg);
+}
+
+void sol_log_64_(u64 arg1, u64 arg2, u64 arg3, u64 arg4, u64 arg5)
+{
+	cu_charge(CU_KIND_LOG_64, CU_LOG_64);
+	if (cu_meter.verbose)
+		printf("Program log: %#lx, %#lx, %#lx, %#lx, %#lx\n", arg1,
+		       arg2, arg3, arg4, arg5);
+}
+
+void sol_log_data(SolBytes *fields, u64 fields_len)
+{
+	u64 units = CU_SYSCALL_BASE + CU_SYSCALL_BASE * fields_len;
+
+	for (u64 i = 0; i < fields_len; ++i)
+		units += fields[i].len;
+
+	cu_charge(CU_KIND_LOG_DATA, units);
+	if (cu_meter.verbose) {
+		printf("Program data:");
+		for (u64 i = 0; i < fields_len; ++i) {
+			printf(" ");
+			for (u64 j = 0; j < fields[i].len; ++j)
+				printf("%02x", fields[i].addr[j]);
+		}
+		printf("\n");
+	}
+}
+
+void sol_log_pubkey(const SolPubkey *pubkey)
+{
+	cu_charge(CU_KIND_LOG, CU_LOG_PUBKEY);
+}
+
+void sol_log_compute_units_(void)
+{
+	cu_charge(CU_KIND_LOG, CU_SYSCALL_BASE);
+	if (cu_meter.verbose)
+		printf("Program consumption: %lu units (syscalls)\n",
+		       cu_total(&cu_meter));
+}
+
+/*
+  same hash and off-curve check as the runtime: an address on the curve
+  fails with 1 like the syscall does.
+ */
+u64 sol_create_program_address(const SolSignerSeed *seeds, int seeds_len,
+			       const SolPubkey *program_id,
+			       SolPubkey *program_address)
+{
+	static const char marker[] = "ProgramDerivedAddress";
+	SHA256_CTX sha;
+
+	cu_charge(CU_KIND_PDA, CU_CREATE_PROGRAM_ADDRESS);
+
+	if (seeds_len > 16)
+		return MAX_SEED_LENGTH_EXCEEDED;
+
+	SHA256Init(&sha);
+	for (int i = 0; i < seeds_len; ++i) {
+		if (seeds[i].len > 32)
+			return MAX_SEED_LENGTH_EXCEEDED;
+		SHA256Update(&sha, seeds[i].addr, seeds[i].len);
+	}
+	SHA256Update(&sha, program_id->x, sizeof(program_id->x));
+	SHA256Update(&sha, (const u8 *)marker, sizeof(marker) - 1);
+	SHA256Final(program_address->x, &sha);
+
+	if (ed25519_on_curve(program_address->x))
+		return 1;
+
+	return SUCCESS;
+}
+
+// bumps from 255 down, every try is charged like the runtime does
+u64 sol_try_find_program_address(const SolSignerSeed *seeds, int seeds_len,
+				 const SolPubkey *program_id,
+				 SolPubkey *program_address, u8 *bump_seed)
+{
+	SolSignerSeed tmp[17];
+	u8 bump;
+	u64 result;
+
+	if (seeds_len > 15)
+		return MAX_SEED_LENGTH_EXCEEDED;
+
+	memcpy(tmp, seeds, seeds_len * sizeof(*seeds));
+	tmp[seeds_len] = (SolSignerSeed){.addr = &bump, .len = 1};
+
+	for (bump = 255; bump > 0; --bump) {
+		result = sol_create_program_address(tmp, seeds_len + 1,
+						    program_id,
+						    program_address);
+		if (result == SUCCESS) {
+			*bump_seed = bump;
+			return SUCCESS;
+		}
+		if (result != 1)
+			return result;
+	}
+
+	return 1;
+}
+
+static bool has_account_info(const SolAccountInfo *infos, int infos_len,
+			     const SolPubkey *key)
+{
+	for (int i = 0; i < infos_len; ++i) {
+		if (SolPubkey_same(infos[i].key, key))
+			return true;
+	}
+
+	return false;
+}
+
+u64 sol_invoke_signed_c(const SolInstruction *instruction,
+			const SolAccountInfo *account_infos,
+			int account_infos_len,
+			const SolSignerSeeds *signers_seeds,
+			int signers_seeds_len)
+{
+	u64 units = CU_INVOKE + instruction->data_len / CU_CPI_BYTES_PER_UNIT;
+
+	for (int i = 0; i < account_infos_len; ++i)
+		units += account_infos[i].data_len / CU_CPI_BYTES_PER_UNIT;
+
+	cu_charge(CU_KIND_INVOKE, units);
+	if (cu_meter.verbose)
+		printf("Program invoke: %u metas, %d infos, %d signers\n",
+		       (unsigned)instruction->account_len, account_infos_len,
+		       signers_seeds_len);
+
+	// like the runtime, every meta and the callee need an account info
+	for (u64 i = 0; i <= instruction->account_len; ++i) {
+		const SolPubkey *key = i < instruction->account_len ?
+			instruction->accounts[i].pubkey : instruction->program_id;
+
+		if (!has_account_info(account_infos, account_infos_len, key)) {
+			printf("Program invoke: missing account info %lu\n", i);
+			return ERROR_NOT_ENOUGH_ACCOUNT_KEYS;
+		}
+	}
+
+	return SUCCESS;
+}
+
+void host_sysvars_reset(void)
+{
+	const u64 lamports_per_byte_year = 3480;
+	const double threshold = 2.0;
+
+	memset(&host_sysvars, 0, sizeof(host_sysvars));
+	memcpy(host_sysvars.rent, &lamports_per_byte_year, sizeof(u64));
+	memcpy(host_sysvars.rent + 8, &threshold, sizeof(double));
+	host_sysvars.rent[16] = 50;
+}
+
+u64 sol_get_clock_sysvar(void *ret)
+{
+	cu_charge(CU_KIND_SYSVAR, CU_SYSVAR_BASE + sizeof(host_sysvars.clock));
+	memcpy(ret, host_sysvars.clock, sizeof(host_sysvars.clock));
+	return SUCCESS;
+}
+
+u64 sol_get_rent_sysvar(void *ret)
+{
+	cu_charge(CU_KIND_SYSVAR, CU_SYSVAR_BASE + sizeof(host_sysvars.rent));
+	memcpy(ret, host_sysvars.rent, sizeof(host_sysvars.rent));
+	return SUCCESS;
+}
+
+static inline u64 mem_op_cost(u64 n)
+{
+	return max((u64)CU_MEM_OP_BASE, n / CU_CPI_BYTES_PER_UNIT);
+}
+
+void sol_memcpy_(void *dst, const void *src, u64 n)
+{
+	cu_charge(CU_KIND_MEM, mem_op_cost(n));
+	memcpy(dst, src, n);
+}
+
+void sol_memmove_(void *dst, const void *src, u64 n)
+{
+	cu_charge(CU_KIND_MEM, mem_op_cost(n));
+	memmove(dst, src, n);
+}
+
+void sol_memset_(void *s, u8 c, u64 n)
+{
+	cu_charge(CU_KIND_MEM, mem_op_cost(n));
+	memset(s, c, n);
+}
+
+void sol_memcmp_(const void *s1, const void *s2, u64 n, i32 *result)
+{
+	cu_charge(CU_KIND_MEM, mem_op_cost(n));
+	*result = memcmp(s1, s2, n);
+}
@@ -0,0 +1,20 @@
+#ifndef _HOST_SYSVARS_H_
+#define _HOST_SYSVARS_H_
+
+#include <stdint.h>
+
+/*
+  what `sol_get_*_sysvar` return on the host. reset to mainnet-like
+  values before every input; the runner copies the Rent/Clock accounts
+  of an input over them when it carries those.
+ */
+struct host_sysvars {
+	uint8_t clock[40];
+	uint8_t rent[24];
+};
+
+extern struct host_sysvars host_sysvars;
+
+void host_sysvars_reset(void);
+
+#endif // _HOST_SYSVARS_H_
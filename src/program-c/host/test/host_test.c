@@ -0,0 +1,614 @@
+/*
+  host tests of mayanswap.
+
+    make -C src/program-c mayanswap-host-test && ./dist/host/mayanswap-host-test
+
+  each case builds a program input the way the runtime serializes it,
+  feeds it to `entrypoint()` and checks the result and the account data
+  the program left behind. CPIs are not executed (see host/sol_stub.c),
+  so cases only cover what the program checks and writes itself.
+ */
+#include "cu_meter.h"
+#include "sha256.h"
+#include "sysvars.h"
+#include "ctx.h"
+#include "layout.h"
+#include "mayan.h"
+#include "spl.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+
+extern u64 entrypoint(const uint8_t *input);
+
+/*
+  an account of a test input. `data` is copied into the input and `out`
+  points at the serialized copy, so a case reads back what the program
+  wrote. an account with the key of an earlier one is serialized as a dup.
+ */
+struct test_acc {
+	SolPubkey key;
+	SolPubkey owner;
+	u64 lamports;
+	const void *data;
+	u64 data_len;
+	bool signer;
+	bool writable;
+
+	u8 *out;
+	u64 *out_lamports;
+	u64 *out_len;
+};
+
+static const SolPubkey test_prog_id = {.x = {
+	0xec, 0x00, 0xde, 0xe0, 0xdb, 0x4c, 0xd0, 0xed, 0xd5, 0x1e, 0x12,
+	0x60, 0x26, 0x28, 0x29, 0xa1, 0x9d, 0x8f, 0x25, 0xf5, 0x02, 0x02,
+	0x93, 0xbf, 0xfc, 0x70, 0xf2, 0x36, 0xff, 0x8a, 0xec, 0x97,
+}};
+
+static _Alignas(16) u8 input_buf[1 << 20];
+static int failed;
+
+#define CHECK(cond)                                                        \
+	do {                                                               \
+		if (!(cond)) {                                             \
+			printf("  %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			failed++;                                          \
+		}                                                          \
+	} while (0)
+
+static SolPubkey test_key(const char *name)
+{
+	SolPubkey key;
+	SHA256_CTX sha;
+
+	SHA256Init(&sha);
+	SHA256Update(&sha, (const u8 *)name, strlen(name));
+	SHA256Final(key.x, &sha);
+	return key;
+}
+
+static u8 *input_put(u8 *ptr, const void *src, u64 len)
+{
+	memcpy(ptr, src, len);
+	return ptr + len;
+}
+
+// serialized like the runtime: u64 count, accounts, data, program id
+static const u8 *test_input(struct test_acc *accs, u64 accs_len,
+			    const void *data, u64 data_len)
+{
+	u8 *ptr = input_buf;
+	u64 zero = 0;
+
+	memset(input_buf, 0, sizeof(input_buf));
+	ptr = input_put(ptr, &accs_len, sizeof(u64));
+
+	for (u64 i = 0; i < accs_len; ++i) {
+		struct test_acc *acc = &accs[i];
+		u64 dup = i;
+
+		for (u64 j = 0; j < i; ++j) {
+			if (SolPubkey_same(&accs[j].key, &acc->key)) {
+				dup = j;
+				break;
+			}
+		}
+		if (dup != i) {
+			*ptr = dup;
+			ptr += 8;
+			acc->out = accs[dup].out;
+			acc->out_lamports = accs[dup].out_lamports;
+			acc->out_len = accs[dup].out_len;
+			continue;
+		}
+
+		ptr[0] = UINT8_MAX;
+		ptr[1] = acc->signer;
+		ptr[2] = acc->writable;
+		ptr += 8;
+		ptr = input_put(ptr, acc->key.x, sizeof(SolPubkey));
+		ptr = input_put(ptr, acc->owner.x, sizeof(SolPubkey));
+		acc->out_lamports = (u64 *)ptr;
+		ptr = input_put(ptr, &acc->lamports, sizeof(u64));
+		acc->out_len = (u64 *)ptr;
+		ptr = input_put(ptr, &acc->data_len, sizeof(u64));
+		acc->out = ptr;
+		ptr = input_put(ptr, acc->data, acc->data_len);
+		ptr += MAX_PERMITTED_DATA_INCREASE;
+		ptr = (u8 *)(((u64)ptr + BPF_ALIGN_OF_U128 - 1) &
+			     ~(u64)(BPF_ALIGN_OF_U128 - 1));
+		ptr = input_put(ptr, &zero, sizeof(u64));
+	}
+
+	ptr = input_put(ptr, &data_len, sizeof(u64));
+	ptr = input_put(ptr, data, data_len);
+	input_put(ptr, test_prog_id.x, sizeof(SolPubkey));
+
+	return input_buf;
+}
+
+static u64 test_run(struct test_acc *accs, u64 accs_len, const void *data,
+		    u64 data_len)
+{
+	const u8 *input = test_input(accs, accs_len, data, data_len);
+
+	host_sysvars_reset();
+	cu_meter_reset();
+	return entrypoint(input);
+}
+
+static SolPubkey test_find_pda(const SolSignerSeed *seeds, int seeds_len,
+			       const SolPubkey *program_id, u8 *bump)
+{
+	SolPubkey addr;
+
+	sol_try_find_program_address(seeds, seeds_len, program_id, &addr, bump);
+	return addr;
+}
+
+// the first seed whose bump 255 lands on the curve
+static void test_pda_search(void)
+{
+	SolPubkey addr;
+	SolPubkey again;
+	char name[16];
+	u8 bump = 255;
+	int n;
+
+	for (n = 0; n < 64; ++n) {
+		snprintf(name, sizeof(name), "seed%d", n);
+		const SolSignerSeed seeds[] = {
+			{.addr = (const u8 *)name, .len = strlen(name)},
+			{.addr = &bump, .len = 1},
+		};
+		if (sol_create_program_address(seeds, 2, &test_prog_id,
+					       &addr) != SUCCESS)
+			break;
+	}
+	CHECK(n < 64);
+
+	const SolSignerSeed seeds[] = {
+		{.addr = (const u8 *)name, .len = strlen(name)},
+		{.addr = &bump, .len = 1},
+	};
+
+	cu_meter_reset();
+	CHECK(sol_try_find_program_address(seeds, 1, &test_prog_id, &addr,
+					   &bump) == SUCCESS);
+	CHECK(bump < 255);
+	CHECK(cu_meter.calls[CU_KIND_PDA] == 256 - bump);
+
+	CHECK(sol_create_program_address(seeds, 2, &test_prog_id, &again) ==
+	      SUCCESS);
+	CHECK(SolPubkey_same(&addr, &again));
+}
+
+static const u16 ledger_chain = 5;
+static const u64 ledger_page = 3;
+
+static SolPubkey ledger_addr(u8 *bump)
+{
+	const SolSignerSeed seeds[] = {
+		{.addr = (const u8 *)"LEDGER", .len = 6},
+		{.addr = (const u8 *)&ledger_chain, .len = 2},
+		{.addr = (const u8 *)&ledger_page, .len = 8},
+	};
+
+	return test_find_pda(seeds, SOL_ARRAY_SIZE(seeds), &test_prog_id, bump);
+}
+
+// the highest bump below the canonical one that is off the curve too
+static SolPubkey ledger_second_addr(u8 canonical, u8 *bump)
+{
+	SolPubkey addr = {0};
+
+	for (*bump = canonical - 1; *bump > 0; --*bump) {
+		const SolSignerSeed seeds[] = {
+			{.addr = (const u8 *)"LEDGER", .len = 6},
+			{.addr = (const u8 *)&ledger_chain, .len = 2},
+			{.addr = (const u8 *)&ledger_page, .len = 8},
+			{.addr = bump, .len = 1},
+		};
+		if (sol_create_program_address(seeds, SOL_ARRAY_SIZE(seeds),
+					       &test_prog_id, &addr) == SUCCESS)
+			break;
+	}
+
+	return addr;
+}
+
+// `header` gets the page header 141 wrote
+static u64 init_ledger(const SolPubkey *page, u8 *header)
+{
+	struct test_acc accs[] = {
+		{.key = test_key("payer"), .lamports = 1000000000,
+		 .signer = true, .writable = true},
+		{.key = *page, .writable = true},
+		{.key = {{0}}},
+	};
+	u8 data[11] = {141};
+	u64 result;
+
+	memcpy(data + 1, &ledger_chain, 2);
+	memcpy(data + 3, &ledger_page, 8);
+
+	result = test_run(accs, SOL_ARRAY_SIZE(accs), data, sizeof(data));
+	memcpy(header, accs[1].out, MAYAN_LEDGER_HEADER_SIZE);
+	return result;
+}
+
+// 141 creates the canonical page only and keeps its bump
+static void test_ledger_second_page(void)
+{
+	SolPubkey canonical;
+	SolPubkey second;
+	u8 header[MAYAN_LEDGER_HEADER_SIZE];
+	u8 bump;
+	u8 second_bump;
+
+	canonical = ledger_addr(&bump);
+	second = ledger_second_addr(bump, &second_bump);
+	CHECK(second_bump > 0);
+
+	CHECK(init_ledger(&canonical, header) == SUCCESS);
+	CHECK(mayan_ledger_chain(header) == ledger_chain);
+	CHECK(mayan_ledger_bump(header) == bump);
+	CHECK(mayan_ledger_page(header) == ledger_page);
+
+	CHECK(init_ledger(&second, header) == ERROR_INVALID_ARGUMENT);
+}
+
+static bool mark_page(const SolPubkey *key, u8 bump)
+{
+	struct prog_ctx ctx = {.prog_id = &test_prog_id};
+	SolPubkey owner = test_prog_id;
+	SolPubkey page = *key;
+	u8 data[MAYAN_LEDGER_SIZE] = {0};
+	SolAccountInfo ledger = {
+		.key = &page,
+		.owner = &owner,
+		.data = data,
+		.data_len = sizeof(data),
+	};
+
+	mayan_ledger_set_chain(data, ledger_chain);
+	mayan_ledger_set_bump(data, bump);
+	mayan_ledger_set_page(data, ledger_page);
+
+	return ledger_mark_claimed(&ctx, &ledger, ledger_chain,
+				   ledger_page * MAYAN_LEDGER_BITS + 7,
+				   true) == SUCCESS;
+}
+
+// claims only take a page whose header derives its address
+static void test_ledger_claim_addr(void)
+{
+	SolPubkey canonical;
+	SolPubkey other = test_key("other");
+	u8 bump;
+
+	canonical = ledger_addr(&bump);
+
+	CHECK(mark_page(&canonical, bump));
+	CHECK(!mark_page(&canonical, bump - 1));
+	CHECK(!mark_page(&other, bump));
+}
+
+// a slot is taken by version, size and owner, then by its state byte
+static void test_free_slot(void)
+{
+	struct prog_ctx ctx = {.prog_id = &test_prog_id};
+	SolPubkey key = test_key("slot");
+	SolPubkey owner = test_prog_id;
+	u8 data[MAYAN_STATE_SIZE] = {0};
+	SolAccountInfo slot = {
+		.key = &key,
+		.owner = &owner,
+		.data = data,
+		.data_len = sizeof(data),
+	};
+
+	CHECK(!is_free_slot(&ctx, &slot));
+
+	mayan_data_set_version(data, MAYAN_STATE_VERSION);
+	CHECK(is_free_slot(&ctx, &slot));
+
+	mayan_data_set_state(data, STATE_CLAIMED);
+	CHECK(!is_free_slot(&ctx, &slot));
+
+	mayan_data_set_state(data, STATE_DONE_SWAPPED);
+	CHECK(is_free_slot(&ctx, &slot));
+
+	slot.data_len = MAYAN_STATE_V1_SIZE;
+	CHECK(!is_free_slot(&ctx, &slot));
+}
+
+/*
+  direct swaps settle the shared open orders, only into MAIN's wallets,
+  token accounts of the token program
+ */
+static u64 direct_wallets(bool direct, const SolPubkey *to_owner,
+			  const SolPubkey *to_prog)
+{
+	struct prog_ctx ctx = {.prog_id = &test_prog_id};
+	struct swap_transitive_acc swap = {.direct = direct};
+	SolPubkey main = test_key("main");
+	SolPubkey market = test_key("market");
+	SolPubkey mint_from = test_key("mint from");
+	SolPubkey mint_to = test_key("mint to");
+	SolPubkey from_key = test_key("from");
+	SolPubkey to_key = test_key("to");
+	SolPubkey spl = SPL_PROGRAM_ID;
+	u8 order[MAYAN_STATE_SIZE] = {0};
+	u8 from[72] = {0};
+	u8 to[72] = {0};
+	SolAccountInfo main_acc = {.key = &main};
+	SolAccountInfo state = {.data = order, .data_len = sizeof(order)};
+	SolAccountInfo market_acc = {.key = &market};
+	SolAccountInfo base = {.data = mint_from.x, .data_len = 32};
+	SolAccountInfo quote = {.data = mint_to.x, .data_len = 32};
+	SolAccountInfo from_acc = {.key = &from_key, .owner = &spl,
+				   .data = from, .data_len = sizeof(from)};
+	SolAccountInfo to_acc = {.key = &to_key, .owner = (SolPubkey *)to_prog,
+				 .data = to, .data_len = sizeof(to)};
+
+	solprogs_init(&ctx.progs);
+	mayan_data_set_market1(order, market.x);
+	mayan_data_set_mint_from(order, mint_from.x);
+	mayan_data_set_mint_to(order, mint_to.x);
+	memcpy(from + 32, main.x, 32);
+	memcpy(to + 32, to_owner->x, 32);
+
+	swap.state = &state;
+	swap.main = &main_acc;
+	swap.m1.market = &market_acc;
+	swap.m1.base_vault = &base;
+	swap.m1.quote_vault = &quote;
+	swap.s_acc.from = &from_acc;
+	swap.s_acc.to = &to_acc;
+
+	return validate_swap_x(&ctx, &swap, false);
+}
+
+static void test_direct_wallets(void)
+{
+	SolPubkey main = test_key("main");
+	SolPubkey other = test_key("other");
+	SolPubkey spl = SPL_PROGRAM_ID;
+
+	CHECK(direct_wallets(true, &main, &spl) == SUCCESS);
+	CHECK(direct_wallets(true, &other, &spl) == ERROR_INVALID_ARGUMENT);
+	CHECK(direct_wallets(true, &main, &test_prog_id) ==
+	      ERROR_INVALID_ARGUMENT);
+	CHECK(direct_wallets(false, &other, &spl) == SUCCESS);
+}
+
+static const u16 mint_chain = 2;
+static const u8 mint_tkn_addr[32] = {0x7a, 0x11};
+
+// ["wrapped", chain be, token address, bump] under the token bridge
+static SolPubkey wrapped_mint(u8 *bump, bool canonical)
+{
+	const SolPubkey bridge = TOKEN_BRIDGE_PROGRAM_ID;
+	SolPubkey addr = {0};
+	u8 chain[2] = {mint_chain >> 8, mint_chain & 0xff};
+	const SolSignerSeed seeds[] = {
+		{.addr = (const u8 *)"wrapped", .len = 7},
+		{.addr = chain, .len = 2},
+		{.addr = mint_tkn_addr, .len = 32},
+		{.addr = bump, .len = 1},
+	};
+
+	addr = test_find_pda(seeds, 3, &bridge, bump);
+	if (canonical)
+		return addr;
+
+	while (--*bump > 0) {
+		if (sol_create_program_address(seeds, 4, &bridge, &addr) ==
+		    SUCCESS)
+			break;
+	}
+	return addr;
+}
+
+// 145 with `payer`, `registry` gets the new registry
+static u64 init_mints(const char *payer, u8 *registry)
+{
+	u8 bump;
+	const SolSignerSeed seeds[] = {
+		{.addr = (const u8 *)"MINTS", .len = 5},
+	};
+	struct test_acc accs[] = {
+		{.key = test_key(payer), .lamports = 1000000000,
+		 .signer = true, .writable = true},
+		{.key = test_find_pda(seeds, 1, &test_prog_id, &bump),
+		 .writable = true},
+		{.key = {{0}}},
+	};
+	u8 data[2] = {145, bump};
+	u64 result;
+
+	result = test_run(accs, SOL_ARRAY_SIZE(accs), data, sizeof(data));
+	memcpy(registry, accs[1].out, MAYAN_MINTS_SIZE);
+	return result;
+}
+
+// 146 of the test token, `registry` is updated in place
+static u64 register_mint(u8 *registry, const SolPubkey *mint_key,
+			 bool initialized, const char *authority)
+{
+	u8 mint[SPL_MINT_SIZE] = {0};
+	u8 data[35] = {146};
+	struct test_acc accs[] = {
+		{.key = test_key("registry"), .owner = test_prog_id,
+		 .writable = true, .data = registry,
+		 .data_len = MAYAN_MINTS_SIZE},
+		{.key = *mint_key, .owner = SPL_PROGRAM_ID, .data = mint,
+		 .data_len = sizeof(mint)},
+		{.key = test_key(authority), .signer = true},
+	};
+	u64 result;
+
+	mint[45] = initialized;
+	memcpy(data + 1, &mint_chain, 2);
+	memcpy(data + 3, mint_tkn_addr, 32);
+
+	result = test_run(accs, SOL_ARRAY_SIZE(accs), data, sizeof(data));
+	memcpy(registry, accs[0].out, MAYAN_MINTS_SIZE);
+	return result;
+}
+
+// only the payer of 145 adds, and only the canonical initialized mint
+static void test_register_mint(void)
+{
+	static u8 registry[MAYAN_MINTS_SIZE];
+	SolPubkey payer = test_key("payer");
+	SolPubkey canonical;
+	SolPubkey lower;
+	u8 bump;
+
+	canonical = wrapped_mint(&bump, true);
+	lower = wrapped_mint(&bump, false);
+	CHECK(bump > 0);
+
+	CHECK(init_mints("payer", registry) == SUCCESS);
+	CHECK(buf_pubkey_same(mayan_mints_authority(registry), &payer));
+
+	CHECK(register_mint(registry, &canonical, true, "other") ==
+	      ERROR_MISSING_REQUIRED_SIGNATURES);
+	CHECK(register_mint(registry, &lower, true, "payer") ==
+	      ERROR_INVALID_ARGUMENT);
+	CHECK(register_mint(registry, &canonical, false, "payer") ==
+	      ERROR_INVALID_ACCOUNT_DATA);
+	CHECK(mayan_mints_count(registry) == 0);
+
+	CHECK(register_mint(registry, &canonical, true, "payer") == SUCCESS);
+	CHECK(mayan_mints_count(registry) == 1);
+	CHECK(buf_pubkey_same(mayan_mint_mint(registry +
+					      MAYAN_MINTS_HEADER_SIZE),
+			      &canonical));
+}
+
+static const u64 reclaim_seq = ledger_page * MAYAN_LEDGER_BITS + 9;
+
+/*
+  a done v2 state of msg1 funded by "payer" for "relayer", closed by 150
+  with the signer, payer account and state given
+ */
+static u64 reclaim_state(const char *signer, const char *payer, u8 state,
+			 struct test_acc *accs)
+{
+	static u8 order[MAYAN_STATE_SIZE];
+	static u8 msg1[VAA_HEADER_SIZE];
+	static u8 ledger[MAYAN_LEDGER_SIZE];
+	const u32 prefix = VAA_POSTED_PREFIX;
+	SolPubkey funder = test_key("payer");
+	SolPubkey relayer = test_key("relayer");
+	u8 data[2] = {150, 1};
+	u8 bump;
+
+	// posted vaa header: prefix at 0, sequence at 49, chain at 57
+	memset(msg1, 0, sizeof(msg1));
+	memcpy(msg1, &prefix, 3);
+	memcpy(msg1 + 49, &reclaim_seq, 8);
+	memcpy(msg1 + 57, &ledger_chain, 2);
+
+	accs[2] = (struct test_acc){.key = test_key("msg1"),
+				    .owner = WORMHOLE_PROGRAM_ID,
+				    .data = msg1, .data_len = sizeof(msg1)};
+
+	memset(order, 0, sizeof(order));
+	mayan_data_set_version(order, MAYAN_STATE_VERSION);
+	mayan_data_set_state(order, state);
+	mayan_data_set_msg1(order, accs[2].key.x);
+	mayan_data_set_payer(order, funder.x);
+	mayan_data_set_relayer(order, relayer.x);
+
+	memset(ledger, 0, sizeof(ledger));
+	accs[3] = (struct test_acc){.key = ledger_addr(&bump),
+				    .owner = test_prog_id, .writable = true,
+				    .data = ledger, .data_len = sizeof(ledger)};
+	mayan_ledger_set_chain(ledger, ledger_chain);
+	mayan_ledger_set_bump(ledger, bump);
+	mayan_ledger_set_page(ledger, ledger_page);
+
+	accs[0] = (struct test_acc){.key = test_key(signer), .lamports = 1000,
+				    .signer = true, .writable = true};
+	accs[1] = (struct test_acc){.key = test_key("order"),
+				    .owner = test_prog_id, .lamports = 2000000,
+				    .writable = true, .data = order,
+				    .data_len = sizeof(order)};
+	accs[4] = (struct test_acc){.key = test_key(payer), .lamports = 1000,
+				    .writable = true};
+
+	return test_run(accs, 5, data, sizeof(data));
+}
+
+/*
+  150 moves the lamports to the state's payer, signed by it or its
+  relayer, zeroes the order and sets its bit
+ */
+static void test_reclaim(void)
+{
+	struct test_acc accs[5];
+	u64 bit = reclaim_seq % MAYAN_LEDGER_BITS;
+	u8 zero[MAYAN_STATE_SIZE] = {0};
+
+	CHECK(reclaim_state("payer", "payer", STATE_DONE_SWAPPED, accs) ==
+	      SUCCESS);
+	CHECK(*accs[4].out_lamports == 1000 + 2000000);
+	CHECK(*accs[1].out_lamports == 0);
+	CHECK(memcmp(accs[1].out, zero, sizeof(zero)) == 0);
+	CHECK(accs[3].out[MAYAN_LEDGER_HEADER_SIZE + bit / 8] &
+	      1 << (bit % 8));
+
+	CHECK(reclaim_state("relayer", "payer", STATE_DONE_NOT_SWAPPED,
+			    accs) == SUCCESS);
+	CHECK(*accs[0].out_lamports == 1000);
+	CHECK(*accs[4].out_lamports == 1000 + 2000000);
+
+	CHECK(reclaim_state("other", "payer", STATE_DONE_SWAPPED, accs) ==
+	      ERROR_MISSING_REQUIRED_SIGNATURES);
+	CHECK(*accs[1].out_lamports == 2000000);
+
+	CHECK(reclaim_state("relayer", "relayer", STATE_DONE_SWAPPED, accs) ==
+	      ERROR_INVALID_ARGUMENT);
+	CHECK(*accs[1].out_lamports == 2000000);
+
+	CHECK(reclaim_state("payer", "payer", STATE_CLAIMED, accs) ==
+	      ERROR_INVALID_ACCOUNT_DATA);
+	CHECK(*accs[1].out_lamports == 2000000);
+}
+
+static const struct {
+	const char *name;
+	void (*run)(void);
+} cases[] = {
+	{"pda search skips bumps on the curve", test_pda_search},
+	{"141 refuses a second page of the same sequences", test_ledger_second_page},
+	{"claims refuse a page not derived from its header", test_ledger_claim_addr},
+	{"slots are v2 states", test_free_slot},
+	{"direct swaps only settle into MAIN's wallets", test_direct_wallets},
+	{"146 adds canonical mints for the registry authority", test_register_mint},
+	{"150 closes done orders to their payer", test_reclaim},
+};
+
+int main(void)
+{
+	int failed_cases = 0;
+
+	for (u64 i = 0; i < SOL_ARRAY_SIZE(cases); ++i) {
+		int before = failed;
+
+		cases[i].run();
+		printf("%s: %s\n", failed == before ? "ok" : "FAIL",
+		       cases[i].name);
+		if (failed != before)
+			failed_cases++;
+	}
+
+	printf("%d of %d cases failed\n", failed_cases,
+	       (int)SOL_ARRAY_SIZE(cases));
+	return failed_cases != 0;
+}
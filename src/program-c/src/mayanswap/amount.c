@@ -0,0 +1,87 @@
+#include "amount.h"
+#include "layout.h"
+
+/*
+  a * b / c with a 128 bit product, false on c == 0 or a result over u64.
+  the long division only runs when the product is over 64 bits.
+ */
+bool amount_mul_div(u64 a, u64 b, u64 c, u64 *result)
+{
+	u64 hi;
+	u64 lo;
+	u64 q = 0;
+
+	if (c == 0)
+		return false;
+
+	lo = amount_mul_wide(a, b, &hi);
+	if (hi == 0) {
+		*result = lo / c;
+		return true;
+	}
+
+	// quotient would not fit
+	if (hi >= c)
+		return false;
+
+	// shift-subtract, the remainder stays below c
+	for (int i = 0; i < 64; ++i) {
+		u64 carry = hi >> 63;
+
+		hi = (hi << 1) | (lo >> 63);
+		lo <<= 1;
+		q <<= 1;
+
+		if (carry || hi >= c) {
+			hi -= c;
+			q |= 1;
+		}
+	}
+
+	*result = q;
+	return true;
+}
+
+bool order_amounts_from_vaa(const struct mayan_vaa_view *vaa, u8 decimal_from,
+			    u8 decimal_to, struct order_amounts *out)
+{
+	u64 scale_from = 1;
+	u64 scale_to = 1;
+	u64 unit;
+
+	// vaa amounts -> token amounts, tokens with <= 8 decimals are unscaled
+
+	if (decimal_from > AMOUNT_VAA_DECIMALS &&
+	    !amount_pow10(decimal_from - AMOUNT_VAA_DECIMALS, &scale_from)) {
+		mayan_error("from decimals are too big");
+		return false;
+	}
+
+	if (decimal_to > AMOUNT_VAA_DECIMALS &&
+	    !amount_pow10(decimal_to - AMOUNT_VAA_DECIMALS, &scale_to)) {
+		mayan_error("to decimals are too big");
+		return false;
+	}
+
+	if (!amount_pow10(decimal_from, &unit)) {
+		mayan_error("rate decimals are too big");
+		return false;
+	}
+
+	if (!amount_mul(vaa->amount, scale_from, &out->amount) ||
+	    !amount_mul(vaa->fee_swap, scale_from, &out->fee_swap) ||
+	    !amount_mul(vaa->amount_min, scale_to, &out->amount_min) ||
+	    !amount_mul(vaa->fee_return, scale_to, &out->fee_return)) {
+		mayan_error("amount overflow");
+		return false;
+	}
+
+	if (!amount_mul_div(out->amount_min, unit, out->amount, &out->rate)) {
+		mayan_error("rate overflow");
+		return false;
+	}
+
+	out->decimal = decimal_from;
+
+	return true;
+}
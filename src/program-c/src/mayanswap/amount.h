@@ -0,0 +1,93 @@
+#ifndef _AMOUNT_H_
+#define _AMOUNT_H_
+
+#include "sol/types.h"
+#include "utils.h"
+#include "vaa.h"
+
+/*
+  fixed point amounts. vaa amounts have 8 decimals, tokens with more are
+  scaled up here, and the rate is amount_min in 10^decimal units of the
+  input. the products are 128 bit wide and anything that does not fit
+  back in u64 is an error instead of a wrapped value.
+ */
+
+#define AMOUNT_VAA_DECIMALS 8
+#define AMOUNT_POW10_MAX 19
+
+static const u64 amount_pow10_table[AMOUNT_POW10_MAX + 1] = {
+	1ULL,
+	10ULL,
+	100ULL,
+	1000ULL,
+	10000ULL,
+	100000ULL,
+	1000000ULL,
+	10000000ULL,
+	100000000ULL,
+	1000000000ULL,
+	10000000000ULL,
+	100000000000ULL,
+	1000000000000ULL,
+	10000000000000ULL,
+	100000000000000ULL,
+	1000000000000000ULL,
+	10000000000000000ULL,
+	100000000000000000ULL,
+	1000000000000000000ULL,
+	10000000000000000000ULL,
+};
+
+// 10^n, false past 10^19 (does not fit in u64)
+static inline bool amount_pow10(u8 n, u64 *result)
+{
+	if (n > AMOUNT_POW10_MAX)
+		return false;
+	*result = amount_pow10_table[n];
+	return true;
+}
+
+// 64x64 -> 128 in 32 bit halves, bpf has no wide multiply
+static inline u64 amount_mul_wide(u64 a, u64 b, u64 *hi)
+{
+	u64 a_lo = (u32)a, a_hi = a >> 32;
+	u64 b_lo = (u32)b, b_hi = b >> 32;
+
+	u64 ll = a_lo * b_lo;
+	u64 lh = a_lo * b_hi;
+	u64 hl = a_hi * b_lo;
+	u64 hh = a_hi * b_hi;
+
+	u64 mid = (ll >> 32) + (u32)lh + (u32)hl;
+
+	*hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+	return (mid << 32) | (u32)ll;
+}
+
+static inline bool amount_mul(u64 a, u64 b, u64 *result)
+{
+	u64 hi;
+
+	*result = amount_mul_wide(a, b, &hi);
+	return hi == 0;
+}
+
+bool amount_mul_div(u64 a, u64 b, u64 c, u64 *result);
+
+/*
+  everything the state needs from one mayan vaa, in token units.
+  `decimal` is the one of the input mint.
+ */
+struct order_amounts {
+	u64 amount;
+	u64 amount_min;
+	u64 rate;
+	u64 fee_swap;
+	u64 fee_return;
+	u8 decimal;
+};
+
+bool order_amounts_from_vaa(const struct mayan_vaa_view *vaa, u8 decimal_from,
+			    u8 decimal_to, struct order_amounts *out);
+
+#endif // _AMOUNT_H_
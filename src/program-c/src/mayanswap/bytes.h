@@ -0,0 +1,71 @@
+#ifndef _MAYAN_BYTES_H_
+#define _MAYAN_BYTES_H_
+
+/*
+  word sized byte primitives: 32 byte copies and compares, big endian
+  loads and stores. the fields they touch are not aligned, bpf loads
+  don't care. included from utils.h, after the u8..u64 types.
+ */
+#include "sol/pubkey.h"
+
+// four words, no memcpy syscall
+static inline void buf32_copy(u8 *dst, const u8 *src)
+{
+	u64 *d = (u64 *)dst;
+	const u64 *s = (const u64 *)src;
+
+	d[0] = s[0];
+	d[1] = s[1];
+	d[2] = s[2];
+	d[3] = s[3];
+}
+
+static inline bool buf32_same(const u8 *a, const u8 *b)
+{
+	const u64 *x = (const u64 *)a;
+	const u64 *y = (const u64 *)b;
+
+	return ((x[0] ^ y[0]) | (x[1] ^ y[1]) | (x[2] ^ y[2]) |
+		(x[3] ^ y[3])) == 0;
+}
+
+static inline bool buf32_zero(const u8 *a)
+{
+	const u64 *x = (const u64 *)a;
+
+	return (x[0] | x[1] | x[2] | x[3]) == 0;
+}
+
+static inline bool buf_pubkey_same(const u8 *data, const SolPubkey *key)
+{
+	return buf32_same(data, key->x);
+}
+
+// SolPubkey_same is a byte loop
+static inline bool pubkey_same(const SolPubkey *a, const SolPubkey *b)
+{
+	return buf32_same(a->x, b->x);
+}
+
+// big endian: one load and a byte swap
+static inline u64 read_u64_be(const u8* data)
+{
+	return __builtin_bswap64(*(const u64 *)data);
+}
+
+static inline u16 read_u16_be(const u8* data)
+{
+	return __builtin_bswap16(*(const u16 *)data);
+}
+
+static inline void write_u16_be(u8 *buffer, u16 x)
+{
+	*(u16 *)buffer = __builtin_bswap16(x);
+}
+
+static inline void write_u64_be(u8 *buffer, u64 x)
+{
+	*(u64 *)buffer = __builtin_bswap64(x);
+}
+
+#endif // _MAYAN_BYTES_H_
@@ -0,0 +1,60 @@
+#ifndef _CHAINS_H_
+#define _CHAINS_H_
+
+#include "sol/types.h"
+#include "utils.h"
+
+/*
+  the chains we route from. a new chain is one line here:
+  `X(name, wormhole chain id, token bridge, mayan bridge)`, the emitters
+  are the 20 byte evm addresses of the contracts. it generates the
+  CHAIN_ID_ names and `wh_chains`, a table indexed by the chain id.
+ */
+#define WH_CHAINS(X)                                                           \
+	X(BSC, 4,                                                              \
+	  WH_EVM(182, 246, 216, 106, 143, 152, 121, 169, 200, 127, 100, 55,    \
+		 104, 217, 239, 195, 140, 29, 166, 231),                       \
+	  WH_EVM(215, 147, 245, 20, 205, 227, 116, 67, 223, 200, 14, 57, 216,  \
+		 228, 14, 147, 35, 166, 60, 171))                              \
+	X(POLYGON, 5,                                                          \
+	  WH_EVM(90, 88, 80, 90, 150, 209, 219, 248, 223, 145, 203, 33, 181,   \
+		 68, 25, 252, 54, 233, 63, 222),                               \
+	  WH_EVM(208, 248, 138, 236, 92, 77, 226, 12, 201, 112, 223, 209, 115, \
+		 86, 76, 177, 132, 37, 225, 238))
+
+// emitters are 32 bytes, evm addresses are left padded with zeros
+#define WH_EVM(...) {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, __VA_ARGS__}
+
+#define CHAIN_ID_SOLANA 1
+#define WH_CHAINS_CAP 64
+
+struct wh_chain {
+	u8 token_bridge[32];
+	u8 mayan_bridge[32];
+	bool known;
+};
+
+#define WH_CHAIN_ID(name, id, token, mayan) CHAIN_ID_##name = (id),
+#define WH_CHAIN_ENTRY(name, id, token, mayan)                                 \
+	[id] = {.token_bridge = token, .mayan_bridge = mayan, .known = true},
+#define WH_CHAIN_FITS(name, id, token, mayan)                                  \
+	_Static_assert((id) != CHAIN_ID_SOLANA && (id) < WH_CHAINS_CAP,        \
+		       #name " is not a routable chain id");
+
+enum { WH_CHAINS(WH_CHAIN_ID) };
+WH_CHAINS(WH_CHAIN_FITS)
+
+static const struct wh_chain wh_chains[WH_CHAINS_CAP] = {
+	WH_CHAINS(WH_CHAIN_ENTRY)
+};
+
+// NULL for the chains we don't route from
+static inline const struct wh_chain *wh_chain_get(u16 chain_id)
+{
+	if (chain_id >= WH_CHAINS_CAP || !wh_chains[chain_id].known)
+		return NULL;
+
+	return &wh_chains[chain_id];
+}
+
+#endif // _CHAINS_H_
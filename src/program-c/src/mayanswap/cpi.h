@@ -0,0 +1,43 @@
+#ifndef _CPI_H_
+#define _CPI_H_
+
+#include "sol/entrypoint.h"
+#include "sol/pubkey.h"
+#include "sol/string.h"
+#include "sol/types.h"
+#include "ctx.h"
+
+/*
+  CPI templates. the metas of an instruction are a static const array
+  with their flags and the keys that never change (programs, sysvars),
+  the data is one with the tag and the constant bytes (layouts in
+  layout.h). a builder copies both and only sets the account keys and
+  the scalars of the call.
+
+  the metas stay positional: an account the callee takes twice (`from`
+  and `tmp` of a transitive swap) is in them twice, mayan_invoke gives
+  its info once.
+ */
+
+#define CPI_W {NULL, true, false}
+#define CPI_R {NULL, false, false}
+#define CPI_S {NULL, false, true}
+#define CPI_WS {NULL, true, true}
+#define CPI_FIXED(key) {(SolPubkey *)&(key), false, false}
+
+static const SolPubkey cpi_system = SYSTEM_PROGRAM_ID;
+static const SolPubkey cpi_spl = SPL_PROGRAM_ID;
+static const SolPubkey cpi_wh_core = WORMHOLE_PROGRAM_ID;
+static const SolPubkey cpi_dex = DEX_PROGRAM_ID;
+static const SolPubkey cpi_rent = RENT_VAR_KEY;
+static const SolPubkey cpi_clock = CLOCK_VAR_KEY;
+
+// `dst` and `tmpl` are arrays of the same type and size
+#define cpi_from_template(dst, tmpl)                                           \
+	do {                                                                   \
+		_Static_assert(sizeof(dst) == sizeof(tmpl),                    \
+			       "template size mismatch");                      \
+		sol_memcpy((dst), (tmpl), sizeof(dst));                        \
+	} while (0)
+
+#endif // _CPI_H_
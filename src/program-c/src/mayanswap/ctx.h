@@ -24,27 +24,38 @@ struct solprogs {
 };
 
 struct rent {
-	SolPubkey key;
-
 	u64 lamport_byte_year;
-	double threshold;
+	u64 threshold; // f64 bits
 	u8 burn_percent;
 };
 
 struct clock {
-	SolPubkey key;
-
 	u64 posix;
 };
 
+/*
+  lazy view over the serialized accounts. an account is decoded into
+  `params->ka` only when the cursor reaches it, so an instruction only
+  pays for (and reserves stack for) the accounts it uses.
+ */
+struct acc_cursor {
+	const u8 *next; // raw input of the next account
+	u64 left; // accounts not decoded yet
+	u64 cap; // slots behind `params->ka`
+	u64 pos; // accounts handed out, CPIs may decode past it
+	bool overflow;
+
+	// handed out past the end, so parsers never see NULL
+	SolAccountInfo none;
+	u64 none_lamports;
+};
+
 struct prog_ctx {
 	SolParameters *params;
 	const SolPubkey *prog_id;
-	SolAccountInfo *cursor;
+	struct acc_cursor cursor;
 	const u8* data_ptr;
 
-	bool invoke_with_seed;
-	
 	SolSignerSeed main_seed[2];
 	SolSignerSeed state_seed[4];
 	SolSignerSeeds seeds[2];
@@ -78,61 +89,210 @@ static inline void solprogs_init(struct solprogs *progs)
 	progs->zero = &progs->system;
 }
 
-// rent
-#define RENT_VAR_KEY (SolPubkey){.x={6, 167, 213, 23, 25, 44, 92, 81, 33, 140, 201, 76, 61, 74, 241, 127, 88, 218, 238, 8, 155, 161, 253, 68, 227, 219, 217, 138, 0, 0, 0, 0}}
-static inline u64 parse_rent_account(struct prog_ctx *ctx, struct rent *rent)
+static inline const u8 *acc_skip(const u8 *input)
 {
-	SolAccountInfo *acc;
+	u64 data_len;
+
+	// duplicate: index + padding
+	if (*input != UINT8_MAX)
+		return input + 8;
+
+	// dup, signer, writable, executable, padding, key, owner, lamports
+	input += 8 + 32 + 32 + 8;
+	data_len = *(u64 *)input;
+	input += sizeof(u64) + data_len + MAX_PERMITTED_DATA_INCREASE;
+	input = (const u8 *)(((u64)input + BPF_ALIGN_OF_U128 - 1) &
+			     ~(u64)(BPF_ALIGN_OF_U128 - 1));
+
+	// rent epoch
+	return input + sizeof(u64);
+}
+
+static inline const u8 *acc_decode(const u8 *input, SolAccountInfo *acc,
+				   const SolAccountInfo *decoded)
+{
+	if (*input != UINT8_MAX) {
+		*acc = decoded[*input];
+		return input + 8;
+	}
+
+	acc->is_signer = input[1] != 0;
+	acc->is_writable = input[2] != 0;
+	acc->executable = input[3];
+	input += 8;
+
+	acc->key = (SolPubkey *)input;
+	input += sizeof(SolPubkey);
+	acc->owner = (SolPubkey *)input;
+	input += sizeof(SolPubkey);
+	acc->lamports = (u64 *)input;
+	input += sizeof(u64);
+	acc->data_len = *(u64 *)input;
+	input += sizeof(u64);
+	acc->data = (u8 *)input;
+
+	input += acc->data_len + MAX_PERMITTED_DATA_INCREASE;
+	input = (const u8 *)(((u64)input + BPF_ALIGN_OF_U128 - 1) &
+			     ~(u64)(BPF_ALIGN_OF_U128 - 1));
+	acc->rent_epoch = *(u64 *)input;
+
+	return input + sizeof(u64);
+}
+
+/*
+  replaces `sol_deserialize`: finds instruction data and program id
+  without decoding a single account. accounts are decoded on demand by
+  `ctx_next_account`.
+ */
+static inline bool ctx_parse_input(const u8 *input, SolParameters *params,
+				   struct acc_cursor *cursor)
+{
+	u64 num;
+
+	if (input == NULL)
+		return false;
+
+	num = *(u64 *)input;
+	input += sizeof(u64);
+
+	cursor->next = input;
+	cursor->left = num;
+
+	for (u64 i = 0; i < num; ++i)
+		input = acc_skip(input);
+
+	params->ka_num = 0;
+	params->data_len = *(u64 *)input;
+	input += sizeof(u64);
+	params->data = input;
+	input += params->data_len;
+	params->program_id = (const SolPubkey *)input;
+
+	return true;
+}
+
+// slots for the accounts of the current instruction
+static inline void ctx_bind_accounts(struct prog_ctx *ctx,
+				     SolAccountInfo *accounts, u64 cap)
+{
+	ctx->params->ka = accounts;
+	ctx->params->ka_num = 0;
+	ctx->cursor.cap = cap;
+	ctx->cursor.pos = 0;
+}
+
+static inline void ctx_decode_one(struct prog_ctx *ctx)
+{
+	struct acc_cursor *cursor = &ctx->cursor;
+	SolParameters *params = ctx->params;
 
-	rent->key = RENT_VAR_KEY;
+	cursor->next = acc_decode(cursor->next, &params->ka[params->ka_num],
+				  params->ka);
+	cursor->left--;
+	params->ka_num++;
+}
+
+static inline SolAccountInfo *ctx_next_account(struct prog_ctx *ctx)
+{
+	struct acc_cursor *cursor = &ctx->cursor;
+	SolParameters *params = ctx->params;
 
-	mayan_debug("parse rent account");
-	acc = ctx->cursor++;
+	if (cursor->pos < params->ka_num)
+		return &params->ka[cursor->pos++];
 
-	if (!SolPubkey_same(&rent->key, acc->key)) {
-		mayan_error("rent address is wrong!");
-		return ERROR_INCORRECT_PROGRAM_ID;
+	if (cursor->left == 0 || params->ka_num >= cursor->cap) {
+		cursor->overflow = true;
+		return &cursor->none;
 	}
 
-	if (acc->data_len < 17) {
-		mayan_error("why rent data is wrong?");
-		return ERROR_ACCOUNT_DATA_TOO_SMALL;
+	ctx_decode_one(ctx);
+	return &params->ka[cursor->pos++];
+}
+
+/*
+  the runtime reads the data length back from the input after the
+  instruction, a program can shrink the accounts it owns in place.
+ */
+static inline void ctx_resize_account(SolAccountInfo *acc, u64 len)
+{
+	*(u64 *)(acc->data - sizeof(u64)) = len;
+	acc->data_len = len;
+}
+
+/*
+  CPIs need every account of the instruction (programs, sysvars). they
+  are decoded but not handed out, `pos` stays so parsing goes on after
+  an invoke.
+ */
+static inline void ctx_decode_rest(struct prog_ctx *ctx)
+{
+	while (ctx->cursor.left > 0 && ctx->params->ka_num < ctx->cursor.cap)
+		ctx_decode_one(ctx);
+}
+
+/*
+  sysvars come from syscalls, the accounts are only in a transaction
+  for the CPIs that list them (dex swaps, wormhole transfers).
+ */
+u64 sol_get_clock_sysvar(void *ret);
+u64 sol_get_rent_sysvar(void *ret);
+
+// rent
+#define RENT_VAR_KEY (SolPubkey){.x={6, 167, 213, 23, 25, 44, 92, 81, 33, 140, 201, 76, 61, 74, 241, 127, 88, 218, 238, 8, 155, 161, 253, 68, 227, 219, 217, 138, 0, 0, 0, 0}}
+#define RENT_THRESHOLD_TWO 0x4000000000000000 // 2.0 as f64
+static inline u64 ctx_load_rent(struct prog_ctx *ctx)
+{
+	// lamports per byte year, exemption threshold (f64), burn percent
+	u64 raw[3];
+	u64 result;
+
+	mayan_debug("load rent");
+	result = sol_get_rent_sysvar(raw);
+	if (result != SUCCESS) {
+		mayan_error("cannot get rent");
+		return result;
 	}
 
-	rent->lamport_byte_year = *(u64 *)(acc->data);
-	rent->threshold = *(double *)(acc->data + 8);
-	rent->burn_percent = acc->data[16];
+	ctx->rent.lamport_byte_year = raw[0];
+	ctx->rent.threshold = raw[1];
+	ctx->rent.burn_percent = (u8)raw[2];
 
 	return SUCCESS;
 }
 
 static inline u64 rent_minimum_balance(const struct rent *rent, u64 size)
 {
-	return ((size + 128) * rent->lamport_byte_year) * rent->threshold;
+	union {
+		u64 bits;
+		double value;
+	} threshold = {.bits = rent->threshold};
+	u64 lamports;
+
+	lamports = (size + 128) * rent->lamport_byte_year;
+
+	// every cluster runs with 2.0, the float path is a soft float call
+	if (rent->threshold == RENT_THRESHOLD_TWO)
+		return lamports * 2;
+
+	return lamports * threshold.value;
 }
 
 // clock
 #define CLOCK_VAR_KEY (SolPubkey){.x={6, 167, 213, 23, 24, 199, 116, 201, 40, 86, 99, 152, 105, 29, 94, 182, 139, 94, 184, 163, 155, 75, 109, 92, 115, 85, 91, 33, 0, 0, 0, 0}}
-static inline u64 parse_clock_account(struct prog_ctx *ctx, struct clock *clk)
+static inline u64 ctx_load_clock(struct prog_ctx *ctx)
 {
-	SolAccountInfo *acc;
-
-	clk->key = CLOCK_VAR_KEY;
-
-	mayan_debug("parse clock account");
-	acc = ctx->cursor++;
-
-	if (!SolPubkey_same(&clk->key, acc->key)) {
-		mayan_error("clock address is wrong!");
-		return ERROR_INCORRECT_PROGRAM_ID;
-	}
+	// slot, epoch start, epoch, leader schedule epoch, unix timestamp
+	u64 raw[5];
+	u64 result;
 
-	if (acc->data_len < 40) {
-		mayan_error("why clcok data is wrong?");
-		return ERROR_ACCOUNT_DATA_TOO_SMALL;
+	mayan_debug("load clock");
+	result = sol_get_clock_sysvar(raw);
+	if (result != SUCCESS) {
+		mayan_error("cannot get clock");
+		return result;
 	}
 
-	clk->posix = *(u64 *)(acc->data + 32);
+	ctx->clock.posix = raw[4];
 
 	return SUCCESS;
 }
@@ -143,8 +303,6 @@ static inline void ctx_init(struct prog_ctx *ctx, SolParameters *params)
 	ctx->params = params;
 	ctx->prog_id = params->program_id;
 
-	ctx->invoke_with_seed = true;
-	
 	ctx->seeds[0] = (SolSignerSeeds){
 		.addr=ctx->state_seed,
 		.len=SOL_ARRAY_SIZE(ctx->state_seed)
@@ -157,24 +315,117 @@ static inline void ctx_init(struct prog_ctx *ctx, SolParameters *params)
 
 
 	ctx->data_ptr = params->data + 1;
-	ctx->cursor = params->ka;
 	ctx->payer = NULL;
 
 	solprogs_init(&ctx->progs);
+
+	ctx->cursor.none = (SolAccountInfo){
+		.key = ctx->progs.zero,
+		.owner = ctx->progs.zero,
+		.lamports = &ctx->cursor.none_lamports,
+	};
 }
 
 
-inline static u64 mayan_invoke(const struct prog_ctx *ctx,
-			       const SolInstruction *ix)
+// who has to sign a CPI, besides the real signers of the transaction
+enum mayan_signer {
+	SIGN_NONE = 0,
+	SIGN_STATE = 1 << 0,
+	SIGN_MAIN = 1 << 1,
+};
+
+// metas + program, the largest CPI is the transitive swap
+#define MAYAN_CPI_INFOS_MAX 28
+
+// keys of parsed accounts point into the input, copies (program ids,
+// sysvars) have to be compared
+static inline SolAccountInfo *ctx_find_account(struct prog_ctx *ctx,
+					       const SolPubkey *key)
 {
-	if (ctx->invoke_with_seed) {
+	SolAccountInfo *ka = ctx->params->ka;
+	u64 num = ctx->params->ka_num;
+
+	for (u64 i = 0; i < num; ++i) {
+		if (ka[i].key == key)
+			return &ka[i];
+	}
+
+	for (u64 i = 0; i < num; ++i) {
+		if (pubkey_same(ka[i].key, key))
+			return &ka[i];
+	}
+
+	return NULL;
+}
+
+static inline bool ctx_add_info(struct prog_ctx *ctx, SolAccountInfo *infos,
+				u64 *infos_len, const SolPubkey *key)
+{
+	SolAccountInfo *acc;
+
+	// repeats of a meta (cpi.h) are the same pointer, no lookup
+	for (u64 i = 0; i < *infos_len; ++i) {
+		if (infos[i].key == key)
+			return true;
+	}
+
+	acc = ctx_find_account(ctx, key);
+	if (acc == NULL) {
+		mayan_error("cpi account not found");
+		sol_log_pubkey(key);
+		return false;
+	}
+
+	// the same account under another pointer (program ids, sysvars)
+	for (u64 i = 0; i < *infos_len; ++i) {
+		if (infos[i].key == acc->key)
+			return true;
+	}
+
+	if (*infos_len >= MAYAN_CPI_INFOS_MAX) {
+		mayan_error("too many cpi accounts");
+		return false;
+	}
+
+	infos[(*infos_len)++] = *acc;
+	return true;
+}
+
+/*
+  the runtime translates every account info and seed it is given, so a
+  CPI only gets the accounts of its metas, its program and the seeds it
+  signs with.
+ */
+inline static u64 mayan_invoke(struct prog_ctx *ctx,
+			       const SolInstruction *ix, u8 signers)
+{
+	SolAccountInfo infos[MAYAN_CPI_INFOS_MAX];
+	SolSignerSeeds seeds[2];
+	u64 infos_len = 0;
+	u64 seeds_len = 0;
+
+	ctx_decode_rest(ctx);
+
+	for (u64 i = 0; i < ix->account_len; ++i) {
+		if (!ctx_add_info(ctx, infos, &infos_len, ix->accounts[i].pubkey))
+			return ERROR_NOT_ENOUGH_ACCOUNT_KEYS;
+	}
+
+	if (!ctx_add_info(ctx, infos, &infos_len, ix->program_id))
+		return ERROR_NOT_ENOUGH_ACCOUNT_KEYS;
+
+	if (signers & SIGN_STATE)
+		seeds[seeds_len++] = ctx->seeds[0];
+	if (signers & SIGN_MAIN)
+		seeds[seeds_len++] = ctx->seeds[1];
+
+	if (seeds_len > 0) {
 		mayan_debug("invoke signed!");
-		return sol_invoke_signed(ix, ctx->params->ka,
-					 ctx->params->ka_num, ctx->seeds,
-					 SOL_ARRAY_SIZE(ctx->seeds));
+		return sol_invoke_signed(ix, infos, infos_len, seeds, seeds_len);
 	}
+
 	mayan_debug("invoke!");
-	return sol_invoke(ix, ctx->params->ka, ctx->params->ka_num);
+	return sol_invoke(ix, infos, infos_len);
 }
 
 
@@ -195,7 +446,7 @@ static inline bool validate_seed_addr(const struct prog_ctx *ctx,
 		return false;
 	}
 
-	if (!SolPubkey_same(key, &tmp))
+	if (!pubkey_same(key, &tmp))
 		return false;
 
 	return true;
@@ -203,6 +454,28 @@ static inline bool validate_seed_addr(const struct prog_ctx *ctx,
 
 static const u8 state_seed[] = {'V', '2', 'S', 'T', 'A', 'T', 'E'};
 static const u8 main_seed[] = {'M', 'A', 'I', 'N'};
+
+#ifdef BUILD_MAIN_KEY
+// canonical MAIN of the deploy key, see build.sh
+static const SolPubkey build_main_key = {.x = BUILD_MAIN_KEY};
+static const u8 build_main_nonce = BUILD_MAIN_NONCE;
+#endif
+static inline void set_ctx_main_seed(struct prog_ctx *ctx,
+				     const u8 *main_nonce)
+{
+	ctx->main_seed[0] = (SolSignerSeed){
+		.addr=main_seed,
+		.len=SOL_ARRAY_SIZE(main_seed)
+	};
+#ifdef BUILD_MAIN_KEY
+	main_nonce = &build_main_nonce;
+#endif
+	ctx->main_seed[1] = (SolSignerSeed){
+		.addr = main_nonce,
+		.len = 1
+	};
+}
+
 static inline void set_ctx_seed(struct prog_ctx *ctx, const u8 *msg1,
 				const u8 *msg2, const u8 *state_nonce,
 				const u8 *main_nonce)
@@ -218,15 +491,7 @@ static inline void set_ctx_seed(struct prog_ctx *ctx, const u8 *msg1,
 		.len=1
 	};
 
-	
-	ctx->main_seed[0] = (SolSignerSeed){
-		.addr=main_seed,
-		.len=SOL_ARRAY_SIZE(main_seed)
-	};
-	ctx->main_seed[1] = (SolSignerSeed){
-		.addr = main_nonce,
-		.len = 1
-	};
+	set_ctx_main_seed(ctx, main_nonce);
 }
 
 static inline u64 ctx_check_seed_addr(struct prog_ctx *ctx,
@@ -244,7 +509,7 @@ static inline u64 ctx_check_seed_addr(struct prog_ctx *ctx,
 		return result;
 	}
 
-	if (!SolPubkey_same(&state_exp, state_key)) {
+	if (!pubkey_same(&state_exp, state_key)) {
 		mayan_error("state addr is wrong");
 		return ERROR_INVALID_ARGUMENT;
 	}
@@ -252,6 +517,18 @@ static inline u64 ctx_check_seed_addr(struct prog_ctx *ctx,
 	return SUCCESS;
 }
 
+#ifdef BUILD_MAIN_KEY
+static inline u64 ctx_check_main_addr(struct prog_ctx *ctx,
+				  const SolPubkey *main_key)
+{
+	if (!pubkey_same(&build_main_key, main_key)) {
+		mayan_error("main addr is wrong");
+		return ERROR_INVALID_ARGUMENT;
+	}
+
+	return SUCCESS;
+}
+#else
 static inline u64 ctx_check_main_addr(struct prog_ctx *ctx,
 				  const SolPubkey *main_key)
 {
@@ -266,12 +543,13 @@ static inline u64 ctx_check_main_addr(struct prog_ctx *ctx,
 		return result;
 	}
 
-	if (!SolPubkey_same(&main_exp, main_key)) {
+	if (!pubkey_same(&main_exp, main_key)) {
 		mayan_error("main addr is wrong");
 		return ERROR_INVALID_ARGUMENT;
 	}
 
 	return SUCCESS;
 }
+#endif
 
 #endif // _CTX_H_
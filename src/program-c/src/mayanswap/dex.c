@@ -1,74 +1,69 @@
 #include "dex.h"
+#include "cpi.h"
+#include "layout.h"
+#include "spl.h"
 #include "sol/types.h"
 #include "utils.h"
 
+/*
+  swap program accounts of one market: market, open orders, request
+  queue, event queue, bids, asks, order payer, base vault, quote vault,
+  vault signer
+ */
+#define SWAP_MARKET_METAS                                                      \
+	CPI_W, CPI_W, CPI_W, CPI_W, CPI_W, CPI_W, CPI_W, CPI_W, CPI_W, CPI_R
+
+static inline void swap_set_market_metas(SolAccountMeta *metas,
+					 const struct serum_market *m,
+					 SolPubkey *payer)
+{
+	metas[0].pubkey = m->market->key;
+	metas[1].pubkey = m->open_orders->key;
+	metas[2].pubkey = m->req_queue->key;
+	metas[3].pubkey = m->event_queue->key;
+	metas[4].pubkey = m->bids->key;
+	metas[5].pubkey = m->asks->key;
+	metas[6].pubkey = payer;
+	metas[7].pubkey = m->base_vault->key;
+	metas[8].pubkey = m->quote_vault->key;
+	metas[9].pubkey = m->vault_signer->key;
+}
+
+// from market + coin wallet, to market + coin wallet, authority, pc wallet
+static const SolAccountMeta swap_transitive_metas[] = {
+	SWAP_MARKET_METAS, CPI_W,
+	SWAP_MARKET_METAS, CPI_W,
+	CPI_S, CPI_W,
+	CPI_FIXED(cpi_dex), CPI_FIXED(cpi_spl), CPI_FIXED(cpi_rent),
+};
+
+// swap_transitive, then the strict min exchange rate (quote decimals 0)
+static const u8 swap_transitive_data[SWAP_TRANSITIVE_IX_SIZE] = {
+	129, 109, 254, 207, 31, 192, 47, 51, [26] = 1,
+};
+
 u64 dex_swap_transitive(struct prog_ctx *ctx, struct serum_market *m1,
 			struct serum_market *m2, struct serum_accs *acc,
 			u64 amount, u64 rate, u8 decimal)
 {
 	SolInstruction ix;
-	u8 data[27];
-	u8* data_ptr;
+	SolAccountMeta accounts[SOL_ARRAY_SIZE(swap_transitive_metas)];
+	u8 data[SWAP_TRANSITIVE_IX_SIZE];
 
 	mayan_debug("dex transitive swap > accs");
-
-	SolAccountMeta accounts[] = {
-		{m1->market->key, true, false},
-		{m1->open_orders->key, true, false},
-		{m1->req_queue->key, true, false},
-		{m1->event_queue->key, true, false},
-		{m1->bids->key, true, false},
-		{m1->asks->key, true, false},
-		{acc->from->key, true, false},
-		{m1->base_vault->key, true, false},
-		{m1->quote_vault->key, true, false},
-		{m1->vault_signer->key, false, false},
-		{acc->from->key, true, false},
-
-		{m2->market->key, true, false},
-		{m2->open_orders->key, true, false},
-		{m2->req_queue->key, true, false},
-		{m2->event_queue->key, true, false},
-		{m2->bids->key, true, false},
-		{m2->asks->key, true, false},
-		{acc->tmp->key, true, false},
-		{m2->base_vault->key, true, false},
-		{m2->quote_vault->key, true, false},
-		{m2->vault_signer->key, false, false},
-		{acc->to->key, true, false},
-		
-		{acc->main, false, true},
-		{acc->tmp->key, true, false},
-
-		{&ctx->progs.dex, false, false},
-		{&ctx->progs.spl, false, false},
-		{&ctx->rent.key, false, false},
-	};
-
+	cpi_from_template(accounts, swap_transitive_metas);
+	swap_set_market_metas(accounts, m1, acc->from->key);
+	accounts[10].pubkey = acc->from->key;
+	swap_set_market_metas(accounts + 11, m2, acc->tmp->key);
+	accounts[21].pubkey = acc->to->key;
+	accounts[22].pubkey = acc->main;
+	accounts[23].pubkey = acc->tmp->key;
 
 	mayan_debug("dex swap > data");
-	data_ptr = data;
-	write_u8(data, &data_ptr, 129);
-	write_u8(data, &data_ptr, 109);
-	write_u8(data, &data_ptr, 254);
-	write_u8(data, &data_ptr, 207);
-	write_u8(data, &data_ptr, 31);
-	write_u8(data, &data_ptr, 192);
-	write_u8(data, &data_ptr, 47);
-	write_u8(data, &data_ptr, 51);
-
-	write_u64(data, &data_ptr, amount);
-
-	// min exchange rate
-	write_u64(data, &data_ptr, rate);
-	write_u8(data, &data_ptr, decimal);
-	write_u8(data, &data_ptr, 0);
-	write_u8(data, &data_ptr, 1);
-
-	if (!check_buffer_is_done(data, data_ptr, SOL_ARRAY_SIZE(data))) {
-		mayan_error("data is not full!");
-		return ERROR_CUSTOM_ZERO;
-	}
+	cpi_from_template(data, swap_transitive_data);
+	swap_transitive_ix_set_amount(data, amount);
+	swap_transitive_ix_set_rate(data, rate);
+	swap_transitive_ix_set_decimal(data, decimal);
 
 	mayan_debug("dex swap > ix");
 	ix.program_id = &(ctx->progs.swap);
@@ -77,65 +72,44 @@ u64 dex_swap_transitive(struct prog_ctx *ctx, struct serum_market *m1,
 	ix.data = data;
 	ix.data_len = SOL_ARRAY_SIZE(data);
 
-	return mayan_invoke(ctx, &ix);
+	return mayan_invoke(ctx, &ix, SIGN_MAIN);
 }
 
+// market + base wallet, authority, quote wallet
+static const SolAccountMeta swap_simple_metas[] = {
+	SWAP_MARKET_METAS, CPI_W,
+	CPI_S, CPI_W,
+	CPI_FIXED(cpi_dex), CPI_FIXED(cpi_spl), CPI_FIXED(cpi_rent),
+};
+
+// swap, then the strict min exchange rate (quote decimals 0)
+static const u8 swap_simple_data[SWAP_SIMPLE_IX_SIZE] = {
+	248, 198, 158, 145, 225, 117, 135, 200, [27] = 1,
+};
+
 u64 dex_swap_simple(struct prog_ctx *ctx, struct serum_market *m1,
 		    struct serum_accs *acc, u8 side, u64 amount, u64 rate,
 		    u8 decimal)
 {
 	SolInstruction ix;
-	u8 data[28];
-	u8* data_ptr;
+	SolAccountMeta accounts[SOL_ARRAY_SIZE(swap_simple_metas)];
+	u8 data[SWAP_SIMPLE_IX_SIZE];
 
 	mayan_debug("dex simple swap > accs");
 	mayan_debug_64(rate, decimal, 0, amount, side);
 
-	SolAccountMeta accounts[] = {
-		{m1->market->key, true, false},
-		{m1->open_orders->key, true, false},
-		{m1->req_queue->key, true, false},
-		{m1->event_queue->key, true, false},
-		{m1->bids->key, true, false},
-		{m1->asks->key, true, false},
-		{acc->from->key, true, false},
-		{m1->base_vault->key, true, false},
-		{m1->quote_vault->key, true, false},
-		{m1->vault_signer->key, false, false},
-		{acc->base, true, false},
-		{acc->main, false, true},
-		{acc->quote, true, false},
-
-		{&ctx->progs.dex, false, false},
-		{&ctx->progs.spl, false, false},
-		{&ctx->rent.key, false, false},
-	};
-
+	cpi_from_template(accounts, swap_simple_metas);
+	swap_set_market_metas(accounts, m1, acc->from->key);
+	accounts[10].pubkey = acc->base;
+	accounts[11].pubkey = acc->main;
+	accounts[12].pubkey = acc->quote;
 
 	mayan_debug("dex swap > data");
-	data_ptr = data;
-	write_u8(data, &data_ptr, 248);
-	write_u8(data, &data_ptr, 198);
-	write_u8(data, &data_ptr, 158);
-	write_u8(data, &data_ptr, 145);
-	write_u8(data, &data_ptr, 225);
-	write_u8(data, &data_ptr, 117);
-	write_u8(data, &data_ptr, 135);
-	write_u8(data, &data_ptr, 200);
-
-	write_u8(data, &data_ptr, side);
-	write_u64(data, &data_ptr, amount);
-
-	// min exchange rate
-	write_u64(data, &data_ptr, rate);
-	write_u8(data, &data_ptr, decimal);
-	write_u8(data, &data_ptr, 0);
-	write_u8(data, &data_ptr, 1);
-
-	if (!check_buffer_is_done(data, data_ptr, SOL_ARRAY_SIZE(data))) {
-		mayan_error("data is not full!");
-		return ERROR_CUSTOM_ZERO;
-	}
+	cpi_from_template(data, swap_simple_data);
+	swap_simple_ix_set_side(data, side);
+	swap_simple_ix_set_amount(data, amount);
+	swap_simple_ix_set_rate(data, rate);
+	swap_simple_ix_set_decimal(data, decimal);
 
 	mayan_debug("dex swap > ix");
 	ix.program_id = &(ctx->progs.swap);
@@ -144,5 +118,240 @@ u64 dex_swap_simple(struct prog_ctx *ctx, struct serum_market *m1,
 	ix.data = data;
 	ix.data_len = SOL_ARRAY_SIZE(data);
 
-	return mayan_invoke(ctx, &ix);
+	return mayan_invoke(ctx, &ix, SIGN_MAIN);
+}
+
+#define DEX_INSTRUCTION_SETTLE_FUNDS 5
+#define DEX_INSTRUCTION_NEW_ORDER_V3 10
+#define DEX_INSTRUCTION_INIT_OPEN_ORDERS 15
+#define DEX_SELF_TRADE_DECREMENT_TAKE 0
+#define DEX_ORDER_IOC 1
+#define DEX_MATCH_LIMIT 65535
+
+/*
+  new_order_v3: market, open orders, request queue, event queue, bids,
+  asks, order payer, open orders owner, base vault, quote vault
+ */
+static const SolAccountMeta dex_new_order_metas[] = {
+	CPI_W, CPI_W, CPI_W, CPI_W, CPI_W, CPI_W, CPI_W, CPI_S, CPI_W, CPI_W,
+	CPI_FIXED(cpi_spl), CPI_FIXED(cpi_rent),
+};
+
+// decrement take, immediate or cancel, client id 0
+static const u8 dex_new_order_data[DEX_NEW_ORDER_IX_SIZE] = {
+	0, DEX_INSTRUCTION_NEW_ORDER_V3,
+	[33] = DEX_SELF_TRADE_DECREMENT_TAKE,
+	[37] = DEX_ORDER_IOC,
+	[49] = DEX_MATCH_LIMIT & 0xff, DEX_MATCH_LIMIT >> 8,
+};
+
+/*
+  `payer` pays the order (base for an ask, quote for a bid), main owns
+  the open orders
+ */
+static u64 dex_new_order(struct prog_ctx *ctx, struct serum_market *m,
+			 const SolPubkey *main, const SolPubkey *payer,
+			 u8 side, u64 limit_price, u64 max_coin, u64 max_pc)
+{
+	SolInstruction ix;
+	SolAccountMeta accounts[SOL_ARRAY_SIZE(dex_new_order_metas)];
+	u8 data[DEX_NEW_ORDER_IX_SIZE];
+
+	mayan_debug("dex new order > accs");
+	cpi_from_template(accounts, dex_new_order_metas);
+	accounts[0].pubkey = m->market->key;
+	accounts[1].pubkey = m->open_orders->key;
+	accounts[2].pubkey = m->req_queue->key;
+	accounts[3].pubkey = m->event_queue->key;
+	accounts[4].pubkey = m->bids->key;
+	accounts[5].pubkey = m->asks->key;
+	accounts[6].pubkey = (SolPubkey *)payer;
+	accounts[7].pubkey = (SolPubkey *)main;
+	accounts[8].pubkey = m->base_vault->key;
+	accounts[9].pubkey = m->quote_vault->key;
+
+	mayan_debug("dex new order > data");
+	cpi_from_template(data, dex_new_order_data);
+	dex_new_order_ix_set_side(data, side);
+	dex_new_order_ix_set_limit_price(data, limit_price);
+	dex_new_order_ix_set_max_coin(data, max_coin);
+	dex_new_order_ix_set_max_pc(data, max_pc);
+
+	ix.program_id = &(ctx->progs.dex);
+	ix.accounts = accounts;
+	ix.account_len = SOL_ARRAY_SIZE(accounts);
+	ix.data = data;
+	ix.data_len = SOL_ARRAY_SIZE(data);
+
+	return mayan_invoke(ctx, &ix, SIGN_MAIN);
+}
+
+/*
+  settle_funds: market, open orders, open orders owner, base vault, quote
+  vault, coin wallet, pc wallet, vault signer
+ */
+static const SolAccountMeta dex_settle_metas[] = {
+	CPI_W, CPI_W, CPI_S, CPI_W, CPI_W, CPI_W, CPI_W, CPI_R,
+	CPI_FIXED(cpi_spl),
+};
+
+static const u8 dex_settle_data[5] = {0, DEX_INSTRUCTION_SETTLE_FUNDS};
+
+// moves the free balances of open orders to the wallets
+u64 dex_settle(struct prog_ctx *ctx, struct serum_market *m,
+	       const SolPubkey *main, const SolPubkey *coin,
+	       const SolPubkey *pc)
+{
+	SolInstruction ix;
+	SolAccountMeta accounts[SOL_ARRAY_SIZE(dex_settle_metas)];
+	u8 data[5];
+
+	mayan_debug("dex settle > accs");
+	cpi_from_template(accounts, dex_settle_metas);
+	accounts[0].pubkey = m->market->key;
+	accounts[1].pubkey = m->open_orders->key;
+	accounts[2].pubkey = (SolPubkey *)main;
+	accounts[3].pubkey = m->base_vault->key;
+	accounts[4].pubkey = m->quote_vault->key;
+	accounts[5].pubkey = (SolPubkey *)coin;
+	accounts[6].pubkey = (SolPubkey *)pc;
+	accounts[7].pubkey = m->vault_signer->key;
+
+	cpi_from_template(data, dex_settle_data);
+
+	ix.program_id = &(ctx->progs.dex);
+	ix.accounts = accounts;
+	ix.account_len = SOL_ARRAY_SIZE(accounts);
+	ix.data = data;
+	ix.data_len = SOL_ARRAY_SIZE(data);
+
+	return mayan_invoke(ctx, &ix, SIGN_MAIN);
+}
+
+// init_open_orders: open orders, open orders owner, market, rent
+static const SolAccountMeta dex_init_open_orders_metas[] = {
+	CPI_W, CPI_S, CPI_R, CPI_FIXED(cpi_rent),
+};
+
+static const u8 dex_init_open_orders_data[5] = {
+	0, DEX_INSTRUCTION_INIT_OPEN_ORDERS,
+};
+
+u64 dex_init_open_orders(struct prog_ctx *ctx, const SolPubkey *market,
+			 const SolPubkey *open_orders, const SolPubkey *main)
+{
+	SolInstruction ix;
+	SolAccountMeta accounts[SOL_ARRAY_SIZE(dex_init_open_orders_metas)];
+	u8 data[5];
+
+	mayan_debug("dex init open orders > accs");
+	cpi_from_template(accounts, dex_init_open_orders_metas);
+	accounts[0].pubkey = (SolPubkey *)open_orders;
+	accounts[1].pubkey = (SolPubkey *)main;
+	accounts[2].pubkey = (SolPubkey *)market;
+
+	cpi_from_template(data, dex_init_open_orders_data);
+
+	ix.program_id = &(ctx->progs.dex);
+	ix.accounts = accounts;
+	ix.account_len = SOL_ARRAY_SIZE(accounts);
+	ix.data = data;
+	ix.data_len = SOL_ARRAY_SIZE(data);
+
+	return mayan_invoke(ctx, &ix, SIGN_MAIN);
+}
+
+/*
+  sells `amount` base (rounded down to lots) or buys base with `amount`
+  quote. same bounds as the swap program: the limit price and the other
+  side are unbounded. `received` is the fill, read on the free balance of
+  the open orders around this order only. it is settled now only with
+  `settle`, otherwise it stays there with the fills of other orders until
+  a sweep. a settle moves those too, the caller checks the wallets are
+  MAIN's (validate_swap_x) so it is the sweep's move.
+ */
+static u64 dex_direct_leg(struct prog_ctx *ctx, struct serum_market *m,
+			  const SolPubkey *main, const SolPubkey *coin,
+			  const SolPubkey *pc, u8 side, u64 amount,
+			  bool settle, u64 *received)
+{
+	u64 result;
+	u64 coin_lots;
+	u64 before;
+	u64 after;
+
+	if (m->market->data_len < SERUM_MARKET_SIZE) {
+		mayan_error("market data is small");
+		return ERROR_ACCOUNT_DATA_TOO_SMALL;
+	}
+
+	if (m->open_orders->data_len < SERUM_OPEN_ORDERS_SIZE) {
+		mayan_error("open orders data is small");
+		return ERROR_ACCOUNT_DATA_TOO_SMALL;
+	}
+
+	if (side == SWAP_SIDE_ASK) {
+		coin_lots = amount / serum_market_coin_lot_size(m->market->data);
+		if (coin_lots == 0) {
+			mayan_error("amount is less than a lot");
+			return ERROR_INSUFFICIENT_FUNDS;
+		}
+
+		before = serum_oo_pc_free(m->open_orders->data);
+		result = dex_new_order(ctx, m, main, coin, side, 1, coin_lots,
+				       UINT64_MAX);
+		after = serum_oo_pc_free(m->open_orders->data);
+	} else {
+		before = serum_oo_coin_free(m->open_orders->data);
+		result = dex_new_order(ctx, m, main, pc, side, UINT64_MAX,
+				       UINT64_MAX, amount);
+		after = serum_oo_coin_free(m->open_orders->data);
+	}
+
+	if (result != SUCCESS)
+		return result;
+
+	*received = after - before;
+	mayan_debug_64(before, after, 0, 0, *received);
+
+	if (!settle)
+		return SUCCESS;
+
+	return dex_settle(ctx, m, main, coin, pc);
+}
+
+u64 dex_direct_simple(struct prog_ctx *ctx, struct serum_market *m1,
+		      struct serum_accs *acc, u8 side, u64 amount,
+		      bool settle, u64 *received)
+{
+	mayan_debug("dex direct simple");
+	return dex_direct_leg(ctx, m1, acc->main, acc->base, acc->quote, side,
+			      amount, settle, received);
+}
+
+/*
+  sells on m1 and settles into the shared quote (tmp), then buys on m2
+  with what the first leg got
+ */
+u64 dex_direct_transitive(struct prog_ctx *ctx, struct serum_market *m1,
+			  struct serum_market *m2, struct serum_accs *acc,
+			  u64 amount, bool settle, u64 *received)
+{
+	u64 result;
+	u64 mid;
+
+	mayan_debug("dex direct transitive");
+	result = dex_direct_leg(ctx, m1, acc->main, acc->from->key,
+				acc->tmp->key, SWAP_SIDE_ASK, amount, true,
+				&mid);
+	if (result != SUCCESS)
+		return result;
+
+	if (mid == 0) {
+		mayan_error("first leg got nothing");
+		return ERROR_CUSTOM_ZERO;
+	}
+
+	return dex_direct_leg(ctx, m2, acc->main, acc->to->key, acc->tmp->key,
+			      SWAP_SIDE_BID, mid, settle, received);
 }
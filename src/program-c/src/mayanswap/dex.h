@@ -37,15 +37,15 @@ enum swap_side {
 static inline u64 parse_market_accounts(struct prog_ctx *ctx,
 					struct serum_market *market)
 {
-	market->market = ctx->cursor++;
-	market->open_orders = ctx->cursor++;
-	market->req_queue = ctx->cursor++;
-	market->event_queue = ctx->cursor++;
-	market->bids = ctx->cursor++;
-	market->asks = ctx->cursor++;
-	market->base_vault = ctx->cursor++;
-	market->quote_vault = ctx->cursor++;
-	market->vault_signer = ctx->cursor++;	
+	market->market = ctx_next_account(ctx);
+	market->open_orders = ctx_next_account(ctx);
+	market->req_queue = ctx_next_account(ctx);
+	market->event_queue = ctx_next_account(ctx);
+	market->bids = ctx_next_account(ctx);
+	market->asks = ctx_next_account(ctx);
+	market->base_vault = ctx_next_account(ctx);
+	market->quote_vault = ctx_next_account(ctx);
+	market->vault_signer = ctx_next_account(ctx);	
 
 	return SUCCESS;
 }
@@ -58,4 +58,26 @@ u64 dex_swap_simple(struct prog_ctx *ctx, struct serum_market *m1,
 		    struct serum_accs *acc, u8 side, u64 amount, u64 rate,
 		    u8 decimal);
 
+/*
+  the same swaps as immediate-or-cancel orders placed on the dex directly,
+  without the swap program in between. prices are not limited, the caller
+  checks `received` against the order minimum. without `settle` the fill
+  stays in the open orders of the market for a later dex_settle (sweep).
+ */
+u64 dex_direct_transitive(struct prog_ctx *ctx, struct serum_market *m1,
+			  struct serum_market *m2, struct serum_accs *acc,
+			  u64 amount, bool settle, u64 *received);
+
+u64 dex_direct_simple(struct prog_ctx *ctx, struct serum_market *m1,
+		      struct serum_accs *acc, u8 side, u64 amount,
+		      bool settle, u64 *received);
+
+u64 dex_settle(struct prog_ctx *ctx, struct serum_market *m,
+	       const SolPubkey *main, const SolPubkey *coin,
+	       const SolPubkey *pc);
+
+// main owns the new open orders, the account is created for the dex before
+u64 dex_init_open_orders(struct prog_ctx *ctx, const SolPubkey *market,
+			 const SolPubkey *open_orders, const SolPubkey *main);
+
 #endif // _DEX_H_
@@ -0,0 +1,60 @@
+#include "event.h"
+#include "mayan.h"
+#include "sol/types.h"
+#include "utils.h"
+
+static inline void event_header(u8 *data, u8 **data_ptr, u8 kind,
+				const u8 *state)
+{
+	write_u8(data, data_ptr, kind);
+	write_buffer(data, data_ptr, mayan_data_msg1(state), 32);
+	write_buffer(data, data_ptr, mayan_data_msg2(state), 32);
+}
+
+static inline void event_emit(const u8 *data, u64 len)
+{
+	SolBytes field = {.addr = data, .len = len};
+
+	sol_log_data(&field, 1);
+}
+
+void mayan_emit_claimed(const u8 *state)
+{
+	u8 data[EVENT_CLAIMED_SIZE];
+	u8 *data_ptr = data;
+
+	event_header(data, &data_ptr, EVENT_CLAIMED, state);
+	write_u64(data, &data_ptr, mayan_data_amount(state));
+	write_u64(data, &data_ptr, mayan_data_amount_min(state));
+	write_u64(data, &data_ptr, mayan_data_rate(state));
+	write_u8(data, &data_ptr, mayan_data_decimal(state));
+	write_u64(data, &data_ptr, mayan_data_deadline(state));
+	write_u16(data, &data_ptr, mayan_data_to_chain(state));
+
+	event_emit(data, SOL_ARRAY_SIZE(data));
+}
+
+void mayan_emit_swapped(const u8 *state, u64 amount_in, u64 amount_out)
+{
+	u8 data[EVENT_SWAPPED_SIZE];
+	u8 *data_ptr = data;
+
+	event_header(data, &data_ptr, EVENT_SWAPPED, state);
+	write_u64(data, &data_ptr, amount_in);
+	write_u64(data, &data_ptr, amount_out);
+
+	event_emit(data, SOL_ARRAY_SIZE(data));
+}
+
+void mayan_emit_transferred(const u8 *state, bool canceled, u64 seq_id)
+{
+	u8 data[EVENT_TRANSFERRED_SIZE];
+	u8 *data_ptr = data;
+	u8 kind = canceled ? EVENT_CANCELED : EVENT_TRANSFERRED;
+
+	event_header(data, &data_ptr, kind, state);
+	write_u64(data, &data_ptr, mayan_data_amount(state));
+	write_u64(data, &data_ptr, seq_id);
+
+	event_emit(data, SOL_ARRAY_SIZE(data));
+}
@@ -0,0 +1,51 @@
+#ifndef _EVENT_H_
+#define _EVENT_H_
+
+#include "sol/types.h"
+#include "utils.h"
+
+/*
+  binary events, one `sol_log_data` field per event. all integers are
+  little endian, offsets are fixed.
+
+  header (65 bytes), all events:
+    0  u8      kind
+    1  [32]u8  msg1
+    33 [32]u8  msg2
+
+  EVENT_CLAIMED (100 bytes):
+    65 u64 amount
+    73 u64 amount_min
+    81 u64 rate
+    89 u8  decimal
+    90 u64 deadline
+    98 u16 to_chain
+
+  EVENT_SWAPPED (81 bytes):
+    65 u64 amount_in (after swap fee)
+    73 u64 amount_out (diff)
+
+  EVENT_TRANSFERRED / EVENT_CANCELED (81 bytes):
+    65 u64 amount
+    73 u64 seq_id (wormhole sequence of the transfer back)
+ */
+enum mayan_event_kind {
+	EVENT_CLAIMED = 1,
+	EVENT_SWAPPED,
+	EVENT_TRANSFERRED,
+	EVENT_CANCELED,
+};
+
+#define EVENT_HEADER_SIZE 65
+#define EVENT_CLAIMED_SIZE (EVENT_HEADER_SIZE + 35)
+#define EVENT_SWAPPED_SIZE (EVENT_HEADER_SIZE + 16)
+#define EVENT_TRANSFERRED_SIZE (EVENT_HEADER_SIZE + 16)
+
+// syscall, not declared by older sdk headers
+void sol_log_data(SolBytes *fields, u64 fields_len);
+
+void mayan_emit_claimed(const u8 *state);
+void mayan_emit_swapped(const u8 *state, u64 amount_in, u64 amount_out);
+void mayan_emit_transferred(const u8 *state, bool canceled, u64 seq_id);
+
+#endif // _EVENT_H_
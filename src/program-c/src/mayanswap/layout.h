@@ -0,0 +1,399 @@
+#ifndef _LAYOUT_H_
+#define _LAYOUT_H_
+
+#include "utils.h"
+
+/*
+  byte layouts of the messages and accounts we read or write.
+
+  every layout is one list of `F(name, kind, offset)` and a size. the
+  list generates the accessors (`prefix_name(data)`, and for writable
+  layouts `prefix_set_name(data, value)`) and a compile time check that
+  every field fits in the size, so a message needs a single
+  `data_len >= SIZE` check before any accessor is used. the offsets are
+  in an enum too (`prefix_off_name`) for bulk copies. our own accounts
+  can also check that every field is aligned (LAYOUT_ALIGNED), their
+  accessors are then single loads.
+
+  kinds:
+    u8, u16, u32, u64   little endian (our own accounts, vaa header, CPIs)
+    u16_be, u64_be      big endian (vaa payloads)
+    buf32               32 bytes, returned as a pointer
+ */
+
+#define LAYOUT_T_u8 u8
+#define LAYOUT_T_u16 u16
+#define LAYOUT_T_u32 u32
+#define LAYOUT_T_u64 u64
+#define LAYOUT_T_u16_be u16
+#define LAYOUT_T_u64_be u64
+#define LAYOUT_T_buf32 const u8 *
+
+#define LAYOUT_SIZE_u8 1
+#define LAYOUT_SIZE_u16 2
+#define LAYOUT_SIZE_u32 4
+#define LAYOUT_SIZE_u64 8
+#define LAYOUT_SIZE_u16_be 2
+#define LAYOUT_SIZE_u64_be 8
+#define LAYOUT_SIZE_buf32 32
+
+// buf32s are copied 8 bytes at a time
+#define LAYOUT_ALIGN_u8 1
+#define LAYOUT_ALIGN_u16 2
+#define LAYOUT_ALIGN_u32 4
+#define LAYOUT_ALIGN_u64 8
+#define LAYOUT_ALIGN_buf32 8
+
+static inline u8 layout_get_u8(const u8 *p) { return *p; }
+static inline u16 layout_get_u16(const u8 *p) { return *(const u16 *)p; }
+static inline u32 layout_get_u32(const u8 *p) { return *(const u32 *)p; }
+static inline u64 layout_get_u64(const u8 *p) { return *(const u64 *)p; }
+static inline const u8 *layout_get_buf32(const u8 *p) { return p; }
+
+static inline u16 layout_get_u16_be(const u8 *p) { return read_u16_be(p); }
+static inline u64 layout_get_u64_be(const u8 *p) { return read_u64_be(p); }
+
+static inline void layout_put_u8(u8 *p, u8 x) { *p = x; }
+static inline void layout_put_u16(u8 *p, u16 x) { *(u16 *)p = x; }
+static inline void layout_put_u32(u8 *p, u32 x) { *(u32 *)p = x; }
+static inline void layout_put_u64(u8 *p, u64 x) { *(u64 *)p = x; }
+
+static inline void layout_put_buf32(u8 *p, const u8 *buf)
+{
+	buf32_copy(p, buf);
+}
+
+// bulk copy of `len` bytes (a multiple of 8) between two layouts
+static inline void layout_copy(u8 *dst, const u8 *src, u64 len)
+{
+	for (u64 i = 0; i < len; i += 8)
+		*(u64 *)(dst + i) = *(const u64 *)(src + i);
+}
+
+#define LAYOUT_GETTER(prefix, name, kind, off)                                 \
+	static inline LAYOUT_T_##kind prefix##_##name(const u8 *data)          \
+	{                                                                      \
+		return layout_get_##kind(data + (off));                        \
+	}
+
+#define LAYOUT_SETTER(prefix, name, kind, off)                                 \
+	static inline void prefix##_set_##name(u8 *data, LAYOUT_T_##kind x)    \
+	{                                                                      \
+		layout_put_##kind(data + (off), x);                            \
+	}
+
+#define LAYOUT_OFFSET(prefix, name, kind, off) prefix##_off_##name = (off),
+
+#define LAYOUT_FITS(size, name, kind, off)                                     \
+	_Static_assert((off) + LAYOUT_SIZE_##kind <= (size),                   \
+		       #name " is out of the layout");
+
+#define LAYOUT_ALIGNED(_, name, kind, off)                                     \
+	_Static_assert((off) % LAYOUT_ALIGN_##kind == 0,                       \
+		       #name " is not aligned");
+
+/*
+  posted vaa account: "vaa" and the vaa header, the payload starts at 95.
+ */
+#define VAA_HEADER_SIZE 96
+#define VAA_POSTED_PREFIX ('v' | 'a' << 8 | 'a' << 16)
+#define VAA_POSTED_PREFIX_MASK 0xffffff
+#define VAA_HEADER_LAYOUT(F, X)                                                \
+	F(X, prefix, u32, 0)                                                   \
+	F(X, seq_id, u64, 49)                                                  \
+	F(X, chain_id, u16, 57)                                                \
+	F(X, emitter_addr, buf32, 59)                                          \
+	F(X, payload_id, u8, 95)
+
+/*
+  token bridge transfer payload (msg1)
+ */
+#define VAA_TRANSFER_SIZE 162
+#define VAA_TRANSFER_LAYOUT(F, X)                                              \
+	F(X, tkn_addr, buf32, 128)                                             \
+	F(X, chain_id, u16_be, 160)
+
+/*
+  mayan swap payload (msg2), u64 amounts are the low bytes of u256s
+ */
+#define VAA_MAYAN_SIZE 396
+#define VAA_MAYAN_LAYOUT(F, X)                                                 \
+	F(X, amount, u64_be, 120)                                              \
+	F(X, tkn_addr, buf32, 128)                                             \
+	F(X, tkn_chain_id, u16_be, 160)                                        \
+	F(X, to_addr, buf32, 162)                                              \
+	F(X, to_chain, u16_be, 194)                                            \
+	F(X, fee_swap, u64_be, 220)                                            \
+	F(X, fee_return, u64_be, 252)                                          \
+	F(X, market1, buf32, 260)                                              \
+	F(X, market2, buf32, 292)                                              \
+	F(X, amount_min, u64_be, 348)                                          \
+	F(X, ref_seq_id, u64_be, 356)                                          \
+	F(X, deadline, u64_be, 388)
+
+/*
+  token bridge transfer with payload (single vaa order): the transfer to
+  MAIN from the mayan bridge, then the swap. amounts are u64s here.
+ */
+#define VAA_SWAP3_SIZE 392
+#define VAA_SWAP3_LAYOUT(F, X)                                                 \
+	F(X, amount, u64_be, 120)                                              \
+	F(X, tkn_addr, buf32, 128)                                             \
+	F(X, tkn_chain_id, u16_be, 160)                                        \
+	F(X, redeemer, buf32, 162)                                             \
+	F(X, redeemer_chain, u16_be, 194)                                      \
+	F(X, sender, buf32, 196)                                               \
+	F(X, tkn_to, buf32, 228)                                               \
+	F(X, tkn_to_chain_id, u16_be, 260)                                     \
+	F(X, to_addr, buf32, 262)                                              \
+	F(X, to_chain, u16_be, 294)                                            \
+	F(X, fee_swap, u64_be, 296)                                            \
+	F(X, fee_return, u64_be, 304)                                          \
+	F(X, market1, buf32, 312)                                              \
+	F(X, market2, buf32, 344)                                              \
+	F(X, amount_min, u64_be, 376)                                          \
+	F(X, deadline, u64_be, 384)
+
+/*
+  state account v2: a version, the bytes, then every field at its
+  alignment. the bumps are always set and `seq` has its own slot.
+  fresh slots are zero, version included. `payer` funded the account and
+  gets its lamports back on reclaim, `relayer` may reclaim for it (zero
+  for none). migrated states have no payer.
+ */
+#define MAYAN_STATE_VERSION 2
+#define MAYAN_STATE_SIZE 360
+#define MAYAN_STATE_LAYOUT(F, X)                                               \
+	F(X, version, u8, 0)                                                   \
+	F(X, state, u8, 1)                                                     \
+	F(X, decimal, u8, 2)                                                   \
+	F(X, state_nonce, u8, 3)                                               \
+	F(X, main_nonce, u8, 4)                                                \
+	F(X, to_chain, u16, 6)                                                 \
+	F(X, amount, u64, 8)                                                   \
+	F(X, rate, u64, 16)                                                    \
+	F(X, seq, u64, 24)                                                     \
+	F(X, fee_swap, u64, 32)                                                \
+	F(X, fee_cancel, u64, 40)                                              \
+	F(X, fee_return, u64, 48)                                              \
+	F(X, deadline, u64, 56)                                                \
+	F(X, amount_min, u64, 64)                                              \
+	F(X, msg1, buf32, 72)                                                  \
+	F(X, msg2, buf32, 104)                                                 \
+	F(X, mint_from, buf32, 136)                                            \
+	F(X, mint_to, buf32, 168)                                              \
+	F(X, to_addr, buf32, 200)                                              \
+	F(X, market1, buf32, 232)                                              \
+	F(X, market2, buf32, 264)                                              \
+	F(X, payer, buf32, 296)                                                \
+	F(X, relayer, buf32, 328)
+
+/*
+  state account v1, read by the migration (147) only. v1.1
+  added amount_min, v1.2 the bumps (zero before). `seq` reuses the rate
+  slot once the order is transferred.
+ */
+#define MAYAN_STATE_V1_SIZE 304
+#define MAYAN_STATE_V1_BUMPS 1
+#define MAYAN_STATE_V1_LAYOUT(F, X)                                            \
+	F(X, state, u8, 0)                                                     \
+	F(X, msg1, buf32, 1)                                                   \
+	F(X, msg2, buf32, 33)                                                  \
+	F(X, amount, u64, 65)                                                  \
+	F(X, decimal, u8, 73)                                                  \
+	F(X, rate, u64, 74)                                                    \
+	F(X, seq, u64, 74)                                                     \
+	F(X, mint_from, buf32, 82)                                             \
+	F(X, mint_to, buf32, 114)                                              \
+	F(X, to_addr, buf32, 146)                                              \
+	F(X, to_chain, u16, 178)                                               \
+	F(X, market1, buf32, 180)                                              \
+	F(X, market2, buf32, 212)                                              \
+	F(X, fee_swap, u64, 244)                                               \
+	F(X, fee_cancel, u64, 252)                                             \
+	F(X, fee_return, u64, 260)                                             \
+	F(X, deadline, u64, 268)                                               \
+	F(X, amount_min, u64, 276)                                             \
+	F(X, state_nonce, u8, 284)                                             \
+	F(X, main_nonce, u8, 285)                                              \
+	F(X, bumps_v, u8, 286)
+
+/*
+  final account of an atomic order: only the state byte
+ */
+#define MAYAN_FINAL_SIZE 1
+#define MAYAN_FINAL_LAYOUT(F, X)                                               \
+	F(X, state, u8, 0)
+
+/*
+  claim ledger page: one bit per token bridge sequence of a chain, bit
+  `seq % MAYAN_LEDGER_BITS` of page `seq / MAYAN_LEDGER_BITS`. the page is
+  ["LEDGER", chain, page, bump] with the canonical bump, kept here.
+ */
+#define MAYAN_LEDGER_BITS 8192
+#define MAYAN_LEDGER_HEADER_SIZE 16
+#define MAYAN_LEDGER_SIZE (MAYAN_LEDGER_HEADER_SIZE + MAYAN_LEDGER_BITS / 8)
+#define MAYAN_LEDGER_LAYOUT(F, X)                                              \
+	F(X, chain, u16, 0)                                                    \
+	F(X, bump, u8, 2)                                                      \
+	F(X, page, u64, 8)
+
+/*
+  wrapped mint registry: a count and the key that adds, then entries
+  sorted by chain and token address. every mint was derived once
+  (canonical bump), when its entry was added.
+ */
+#define MAYAN_MINTS_CAP 64
+#define MAYAN_MINTS_HEADER_SIZE 40
+#define MAYAN_MINTS_ENTRY_SIZE 72
+#define MAYAN_MINTS_SIZE                                                       \
+	(MAYAN_MINTS_HEADER_SIZE + MAYAN_MINTS_CAP * MAYAN_MINTS_ENTRY_SIZE)
+#define MAYAN_MINTS_LAYOUT(F, X)                                               \
+	F(X, count, u64, 0)                                                    \
+	F(X, authority, buf32, 8)
+#define MAYAN_MINT_ENTRY_LAYOUT(F, X)                                          \
+	F(X, chain, u16, 0)                                                    \
+	F(X, tkn_addr, buf32, 8)                                               \
+	F(X, mint, buf32, 40)
+
+/*
+  serum dex market state (read only), after the 5 byte "serum" head
+ */
+#define SERUM_MARKET_SIZE 388
+#define SERUM_MARKET_LAYOUT(F, X)                                              \
+	F(X, coin_lot_size, u64, 349)                                          \
+	F(X, pc_lot_size, u64, 357)
+
+/*
+  serum dex open orders (read only). taker fills are credited to the free
+  balances right away, settle_funds moves them out.
+ */
+#define SERUM_OPEN_ORDERS_SIZE 3228
+#define SERUM_OPEN_ORDERS_LAYOUT(F, X)                                         \
+	F(X, market, buf32, 13)                                                \
+	F(X, owner, buf32, 45)                                                 \
+	F(X, coin_free, u64, 77)                                               \
+	F(X, pc_free, u64, 93)
+
+/*
+  CPI instruction data (cpi.h): the templates have the tag and the
+  constant bytes, the builders set these.
+ */
+#define SWAP_TRANSITIVE_IX_SIZE 27
+#define SWAP_TRANSITIVE_IX_LAYOUT(F, X)                                        \
+	F(X, amount, u64, 8)                                                   \
+	F(X, rate, u64, 16)                                                    \
+	F(X, decimal, u8, 24)
+
+#define SWAP_SIMPLE_IX_SIZE 28
+#define SWAP_SIMPLE_IX_LAYOUT(F, X)                                            \
+	F(X, side, u8, 8)                                                      \
+	F(X, amount, u64, 9)                                                   \
+	F(X, rate, u64, 17)                                                    \
+	F(X, decimal, u8, 25)
+
+#define DEX_NEW_ORDER_IX_SIZE 51
+#define DEX_NEW_ORDER_IX_LAYOUT(F, X)                                          \
+	F(X, side, u32, 5)                                                     \
+	F(X, limit_price, u64, 9)                                              \
+	F(X, max_coin, u64, 17)                                                \
+	F(X, max_pc, u64, 25)
+
+#define WH_TRANSFER_IX_SIZE 55
+#define WH_TRANSFER_IX_LAYOUT(F, X)                                            \
+	F(X, tag, u8, 0)                                                       \
+	F(X, nonce, u32, 1)                                                    \
+	F(X, amount, u64, 5)                                                   \
+	F(X, relayer_fee, u64, 13)                                             \
+	F(X, address, buf32, 21)                                               \
+	F(X, chain, u16, 53)
+
+#define SYSTEM_TRANSFER_IX_SIZE 12
+#define SYSTEM_TRANSFER_IX_LAYOUT(F, X)                                        \
+	F(X, lamports, u64, 4)
+
+#define SPL_APPROVE_IX_SIZE 9
+#define SPL_APPROVE_IX_LAYOUT(F, X)                                            \
+	F(X, amount, u64, 1)
+
+#define SYSTEM_CREATE_IX_SIZE 52
+#define SYSTEM_CREATE_IX_LAYOUT(F, X)                                          \
+	F(X, tag, u32, 0)                                                      \
+	F(X, lamports, u64, 4)                                                 \
+	F(X, space, u64, 12)                                                   \
+	F(X, owner, buf32, 20)
+
+VAA_HEADER_LAYOUT(LAYOUT_GETTER, vaa)
+VAA_HEADER_LAYOUT(LAYOUT_FITS, VAA_HEADER_SIZE)
+
+VAA_TRANSFER_LAYOUT(LAYOUT_GETTER, vaa_transfer)
+VAA_TRANSFER_LAYOUT(LAYOUT_FITS, VAA_TRANSFER_SIZE)
+
+VAA_MAYAN_LAYOUT(LAYOUT_GETTER, vaa_mayan)
+VAA_MAYAN_LAYOUT(LAYOUT_FITS, VAA_MAYAN_SIZE)
+enum { VAA_MAYAN_LAYOUT(LAYOUT_OFFSET, vaa_mayan) };
+
+VAA_SWAP3_LAYOUT(LAYOUT_GETTER, vaa_swap3)
+VAA_SWAP3_LAYOUT(LAYOUT_FITS, VAA_SWAP3_SIZE)
+enum { VAA_SWAP3_LAYOUT(LAYOUT_OFFSET, vaa_swap3) };
+
+MAYAN_STATE_LAYOUT(LAYOUT_GETTER, mayan_data)
+MAYAN_STATE_LAYOUT(LAYOUT_SETTER, mayan_data)
+MAYAN_STATE_LAYOUT(LAYOUT_FITS, MAYAN_STATE_SIZE)
+MAYAN_STATE_LAYOUT(LAYOUT_ALIGNED, _)
+enum { MAYAN_STATE_LAYOUT(LAYOUT_OFFSET, mayan_data) };
+
+MAYAN_STATE_V1_LAYOUT(LAYOUT_GETTER, mayan_v1)
+MAYAN_STATE_V1_LAYOUT(LAYOUT_FITS, MAYAN_STATE_V1_SIZE)
+
+MAYAN_FINAL_LAYOUT(LAYOUT_GETTER, mayan_final)
+MAYAN_FINAL_LAYOUT(LAYOUT_SETTER, mayan_final)
+MAYAN_FINAL_LAYOUT(LAYOUT_FITS, MAYAN_FINAL_SIZE)
+
+MAYAN_MINTS_LAYOUT(LAYOUT_GETTER, mayan_mints)
+MAYAN_MINTS_LAYOUT(LAYOUT_SETTER, mayan_mints)
+MAYAN_MINTS_LAYOUT(LAYOUT_FITS, MAYAN_MINTS_HEADER_SIZE)
+
+MAYAN_MINT_ENTRY_LAYOUT(LAYOUT_GETTER, mayan_mint)
+MAYAN_MINT_ENTRY_LAYOUT(LAYOUT_SETTER, mayan_mint)
+MAYAN_MINT_ENTRY_LAYOUT(LAYOUT_FITS, MAYAN_MINTS_ENTRY_SIZE)
+
+SERUM_MARKET_LAYOUT(LAYOUT_GETTER, serum_market)
+SERUM_MARKET_LAYOUT(LAYOUT_FITS, SERUM_MARKET_SIZE)
+
+SERUM_OPEN_ORDERS_LAYOUT(LAYOUT_GETTER, serum_oo)
+SERUM_OPEN_ORDERS_LAYOUT(LAYOUT_FITS, SERUM_OPEN_ORDERS_SIZE)
+
+enum { MAYAN_LEDGER_LAYOUT(LAYOUT_OFFSET, mayan_ledger) };
+MAYAN_LEDGER_LAYOUT(LAYOUT_GETTER, mayan_ledger)
+MAYAN_LEDGER_LAYOUT(LAYOUT_SETTER, mayan_ledger)
+MAYAN_LEDGER_LAYOUT(LAYOUT_FITS, MAYAN_LEDGER_HEADER_SIZE)
+
+SWAP_TRANSITIVE_IX_LAYOUT(LAYOUT_SETTER, swap_transitive_ix)
+SWAP_TRANSITIVE_IX_LAYOUT(LAYOUT_FITS, SWAP_TRANSITIVE_IX_SIZE)
+
+SWAP_SIMPLE_IX_LAYOUT(LAYOUT_SETTER, swap_simple_ix)
+SWAP_SIMPLE_IX_LAYOUT(LAYOUT_FITS, SWAP_SIMPLE_IX_SIZE)
+
+DEX_NEW_ORDER_IX_LAYOUT(LAYOUT_SETTER, dex_new_order_ix)
+DEX_NEW_ORDER_IX_LAYOUT(LAYOUT_FITS, DEX_NEW_ORDER_IX_SIZE)
+
+WH_TRANSFER_IX_LAYOUT(LAYOUT_SETTER, wh_transfer_ix)
+WH_TRANSFER_IX_LAYOUT(LAYOUT_FITS, WH_TRANSFER_IX_SIZE)
+
+SYSTEM_TRANSFER_IX_LAYOUT(LAYOUT_SETTER, system_transfer_ix)
+SYSTEM_TRANSFER_IX_LAYOUT(LAYOUT_FITS, SYSTEM_TRANSFER_IX_SIZE)
+
+SPL_APPROVE_IX_LAYOUT(LAYOUT_SETTER, spl_approve_ix)
+SPL_APPROVE_IX_LAYOUT(LAYOUT_FITS, SPL_APPROVE_IX_SIZE)
+
+SYSTEM_CREATE_IX_LAYOUT(LAYOUT_SETTER, system_create_ix)
+SYSTEM_CREATE_IX_LAYOUT(LAYOUT_FITS, SYSTEM_CREATE_IX_SIZE)
+
+// msg2 -> state projection copies both markets at once
+_Static_assert(vaa_mayan_off_market2 == vaa_mayan_off_market1 + 32 &&
+	       vaa_swap3_off_market2 == vaa_swap3_off_market1 + 32 &&
+	       mayan_data_off_market2 == mayan_data_off_market1 + 32,
+	       "markets are not next to each other");
+
+#endif // _LAYOUT_H_
@@ -1,4 +1,6 @@
 #include "mayan.h"
+#include "amount.h"
+#include "chains.h"
 #include "sol/entrypoint.h"
 #include "sol/pubkey.h"
 #include "sol/string.h"
@@ -6,177 +8,447 @@
 #include "spl.h"
 #include "utils.h"
 
-bool validate_mint_accounts(struct prog_ctx *ctx, struct claim_acc *mayan)
+// chain, then the token address as a big endian number
+static int mints_cmp(const u8 *entry, u16 chain, const u8 *tkn_addr)
 {
-	SolPubkey from;
-	SolPubkey to;
-	u8* addr_from = vaa_transfer_tkn_addr(mayan->msg1->data);
-	u8* addr_to = vaa_mayan_tkn_addr(mayan->msg2->data);
+	const u8 *addr = mayan_mint_tkn_addr(entry);
+	u64 a;
+	u64 b;
+
+	if (mayan_mint_chain(entry) != chain)
+		return mayan_mint_chain(entry) < chain ? -1 : 1;
+
+	for (int i = 0; i < 32; i += 8) {
+		a = read_u64_be(addr + i);
+		b = read_u64_be(tkn_addr + i);
+		if (a != b)
+			return a < b ? -1 : 1;
+	}
+
+	return 0;
+}
+
+// index of the entry, or where it goes (`found` false)
+static u64 mints_search(const u8 *registry, u16 chain, const u8 *tkn_addr,
+			bool *found)
+{
+	const u8 *entries = registry + MAYAN_MINTS_HEADER_SIZE;
+	u64 lo = 0;
+	u64 hi = mayan_mints_count(registry);
+	u64 mid;
+	int cmp;
+
+	if (hi > MAYAN_MINTS_CAP)
+		hi = MAYAN_MINTS_CAP;
+
+	*found = false;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		cmp = mints_cmp(entries + mid * MAYAN_MINTS_ENTRY_SIZE, chain,
+				tkn_addr);
+		if (cmp == 0) {
+			*found = true;
+			return mid;
+		}
+
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/*
+  adds the wrapped mint of a token, derived here once with the canonical
+  bump. only the registry's authority adds, so its 64 entries cannot be
+  taken by other tokens; an entry is only ever the initialized token
+  bridge mint of its token.
+ */
+u64 mints_add(struct prog_ctx *ctx, SolAccountInfo *registry,
+	      const SolAccountInfo *mint, const SolAccountInfo *authority,
+	      u16 chain, const u8 *tkn_addr)
+{
+	SolPubkey expected;
+	u8 *entries;
+	u8 *entry;
+	u64 count;
+	u64 idx;
+	bool found;
 	u64 result;
 
-	u16 chain_from = vaa_transfer_chain_id(mayan->msg1->data);
-	u16 chain_to = vaa_mayan_tkn_chain_id(mayan->msg2->data);
+	if (!is_mint_registry(ctx, registry)) {
+		mayan_error("not a mint registry");
+		return ERROR_INVALID_ARGUMENT;
+	}
 
-	u8 n1 = mayan->mint_from_nonce;
-	u8 n2 = mayan->mint_to_nonce;
+	if (!authority->is_signer ||
+	    !buf_pubkey_same(mayan_mints_authority(registry->data),
+			     authority->key)) {
+		mayan_error("not the registry authority");
+		return ERROR_MISSING_REQUIRED_SIGNATURES;
+	}
 
-	mayan_debug("validate mint accounts");
-	mayan_debug_64(chain_from, chain_to, 0, n1, n2);
+	// solana tokens are their own mint, nothing to cache
+	if (chain == CHAIN_ID_SOLANA) {
+		mayan_error("native token");
+		return ERROR_INVALID_ARGUMENT;
+	}
 
-	mayan_debug("> from");
-	result = wh_get_mint(ctx, addr_from, chain_from, n1, &from);
-	if (result != SUCCESS) {
-		mayan_error("cannot parse `from` mint");
-		return false;
+	result = wh_find_mint(ctx, tkn_addr, chain, &expected);
+	if (result != SUCCESS)
+		return result;
+
+	if (!pubkey_same(&expected, mint->key)) {
+		mayan_error("mint is not the wrapped mint");
+		return ERROR_INVALID_ARGUMENT;
 	}
 
-	if (!SolPubkey_same(&from, mayan->mint_from->key)) {
-		mayan_error("`from` mint key mismatches");
-		return false;
+	// attested: the token bridge created and initialized it
+	if (!spl_is_mint(ctx, mint)) {
+		mayan_error("wrapped mint is not initialized");
+		return ERROR_INVALID_ACCOUNT_DATA;
 	}
 
-	mayan_debug("> to");
-	result = wh_get_mint(ctx, addr_to, chain_to, n2, &to);
-	if (result != SUCCESS) {
-		mayan_error("cannot parse `to` mint");
+	count = mayan_mints_count(registry->data);
+	idx = mints_search(registry->data, chain, tkn_addr, &found);
+	if (found) {
+		mayan_error("mint already added");
+		return ERROR_ACCOUNT_ALREADY_INITIALIZED;
+	}
+
+	if (count >= MAYAN_MINTS_CAP) {
+		mayan_error("mint registry is full");
+		return ERROR_ACCOUNT_DATA_TOO_SMALL;
+	}
+
+	entries = registry->data + MAYAN_MINTS_HEADER_SIZE;
+	for (u64 i = count; i > idx; --i)
+		layout_copy(entries + i * MAYAN_MINTS_ENTRY_SIZE,
+			    entries + (i - 1) * MAYAN_MINTS_ENTRY_SIZE,
+			    MAYAN_MINTS_ENTRY_SIZE);
+
+	entry = entries + idx * MAYAN_MINTS_ENTRY_SIZE;
+	sol_memset(entry, 0, MAYAN_MINTS_ENTRY_SIZE);
+	mayan_mint_set_chain(entry, chain);
+	mayan_mint_set_tkn_addr(entry, tkn_addr);
+	mayan_mint_set_mint(entry, mint->key->x);
+	mayan_mints_set_count(registry->data, count + 1);
+
+	return SUCCESS;
+}
+
+/*
+  a token in the registry is a search and a compare, the others derive
+  their mint with the nonce of the instruction
+ */
+static bool check_mint(struct prog_ctx *ctx, const SolAccountInfo *registry,
+		       const u8 *tkn_addr, u16 chain, u8 nonce,
+		       const SolPubkey *mint)
+{
+	SolPubkey expected;
+	const u8 *entry;
+	u64 idx;
+	bool found = false;
+
+	if (chain != CHAIN_ID_SOLANA && is_mint_registry(ctx, registry))
+		idx = mints_search(registry->data, chain, tkn_addr, &found);
+
+	if (found) {
+		entry = registry->data + MAYAN_MINTS_HEADER_SIZE +
+			idx * MAYAN_MINTS_ENTRY_SIZE;
+		return buf_pubkey_same(mayan_mint_mint(entry), mint);
+	}
+
+	if (wh_get_mint(ctx, tkn_addr, chain, nonce, &expected) != SUCCESS) {
+		mayan_error("cannot derive mint");
 		return false;
 	}
 
-	if (!SolPubkey_same(&to, mayan->mint_to->key)) {
-		mayan_error("`to` mint key mismatches");
+	return pubkey_same(&expected, mint);
+}
+
+bool validate_mint_accounts(struct prog_ctx *ctx,
+			    const struct claim_acc *mayan,
+			    const SolAccountInfo *registry)
+{
+	mayan_debug("validate mint accounts");
+	mayan_debug_64(mayan->vaa.tkn_from_chain, mayan->vaa.tkn_to_chain, 0,
+		       mayan->mint_from_nonce, mayan->mint_to_nonce);
+
+	mayan_debug("> from");
+	if (!check_mint(ctx, registry, mayan->vaa.tkn_from,
+			mayan->vaa.tkn_from_chain, mayan->mint_from_nonce,
+			mayan->mint_from->key)) {
+		mayan_error("`from` mint key mismatches");
 		return false;
 	}
 
+	if (!validate_mint_to(ctx, mayan, registry))
+		return false;
+
 	mayan_debug("mints were fine (for now)!");
 
 	return true;
 }
 
-static inline u64 denormalize_amount(u64 amount, const SolAccountInfo *mint)
+bool validate_mint_to(struct prog_ctx *ctx, const struct claim_acc *mayan,
+		      const SolAccountInfo *registry)
 {
-	u8 decimal = spl_get_decimals(mint);
-	if (decimal > 8) {
-		mayan_debug(">> amount denormalizing!!!");
-		amount *= decimal_pow(decimal - 8);
-		mayan_debug_64(decimal, 0, decimal_pow(decimal - 8), 0, amount);
+	mayan_debug("> to");
+	if (!check_mint(ctx, registry, mayan->vaa.tkn_to,
+			mayan->vaa.tkn_to_chain, mayan->mint_to_nonce,
+			mayan->mint_to->key)) {
+		mayan_error("`to` mint key mismatches");
+		return false;
 	}
-	return amount;
+
+	return true;
 }
 
-#define MAYAN_STATE_TMP_SIZE (MAYAN_STATE_DATA_SIZE + 20)
 bool mayan_init_state(struct prog_ctx *ctx, struct claim_acc *mayan)
 {
-	u64 amount;
-	u64 amount_min;
-
-	u64 fee_swap;
-	u64 fee_cancel;
-	u64 fee_return;
-	u64 deadline;
+	mayan_debug("mayan init state");
+	if (ctx_create_account(ctx, mayan->state->key,
+			       MAYAN_STATE_SIZE) != SUCCESS)
+		return false;
 
-	u8 *data;
-	u8 *data_ptr;
+	mayan_debug("account created");
+	mayan_debug_64(mayan->state->data_len, 0, 0, 0, 0);
 
-	const u8 *msg1;
-	const u8 *msg2;
-	const u8 *market1;
-	const u8 *market2;
-	const u8 *mint_from;
-	const u8 *mint_to;
-	const u8 *to_addr;
-	u16 to_chain;
+	// the owner funded it, no relayer
+	mayan_data_set_payer(mayan->state->data, ctx->payer->x);
 
-	u64 rate;
-	u8 decimal;
+	return mayan_write_state(mayan);
+}
 
-	
-	mayan_debug("mayan init state");
-	ctx_create_account(ctx, mayan->state->key, MAYAN_STATE_TMP_SIZE);
+// fills `mayan->state->data`, it may be an account or a buffer
+bool mayan_write_state(struct claim_acc *mayan)
+{
+	const struct mayan_vaa_view *vaa = &mayan->vaa;
+	u8 *data = mayan->state->data;
 
-	mayan_debug("account created");
-	mayan_debug_64(mayan->state->data_len, 0, 0, 0, 0);
+	struct order_amounts amt;
 
 	mayan_debug("calculating state");
-	msg1 = (u8 *)mayan->msg1->key;
-	msg2 = (u8 *)mayan->msg2->key;
+	if (!order_amounts_from_vaa(vaa, spl_get_decimals(mayan->mint_from),
+				    spl_get_decimals(mayan->mint_to), &amt))
+		return false;
 
-	amount = vaa_mayan_amount(mayan->msg2->data);
-	amount_min = vaa_mayan_amount_min(mayan->msg2->data);
+	mayan_debug("> rate / decimals");
+	mayan_debug_64(amt.rate, amt.decimal, 0, 0, 0);
 
-	amount = denormalize_amount(amount, mayan->mint_from);
-	amount_min = denormalize_amount(amount_min, mayan->mint_to);
+	mayan_debug("setting state");
+	mayan_data_set_version(data, MAYAN_STATE_VERSION);
+	mayan_data_set_state(data, STATE_CLAIMED);
+	mayan_data_set_msg1(data, mayan->msg1->key->x);
+	mayan_data_set_msg2(data, mayan->msg2->key->x);
+	mayan_data_set_amount(data, amt.amount);
+	mayan_data_set_decimal(data, amt.decimal);
+	mayan_data_set_rate(data, amt.rate);
+	mayan_data_set_seq(data, 0);
+	mayan_data_set_mint_from(data, mayan->mint_from->key->x);
+	mayan_data_set_mint_to(data, mayan->mint_to->key->x);
+	mayan_data_set_to_addr(data, vaa->to_addr);
+	mayan_data_set_to_chain(data, vaa->to_chain);
+
+	// both markets are next to each other in the vaa and the state
+	layout_copy(data + mayan_data_off_market1, vaa->markets, 64);
+
+	mayan_data_set_fee_swap(data, amt.fee_swap);
+	mayan_data_set_fee_cancel(data, 0);
+	mayan_data_set_fee_return(data, amt.fee_return);
+	mayan_data_set_deadline(data, vaa->deadline);
+	mayan_data_set_amount_min(data, amt.amount_min);
+
+	mayan_data_set_state_nonce(data, mayan->state_nonce);
+	mayan_data_set_main_nonce(data, mayan->main_nonce);
 
-	decimal = spl_get_decimals(mayan->mint_from);
-	rate = amount_min * decimal_pow(decimal) / amount;
+	return true;
+}
 
-	mint_from = mayan->mint_from->key->x;
-	mint_to = mayan->mint_to->key->x;
+/*
+  rewrites a v1 state as v2 in place and grows it, the caller tops up its
+  rent first. the bumps of a v1.2 state are trusted like before, older
+  states derive both addresses from the nonces. slots without an order
+  are only cleared. v1 states kept no payer, so none is recorded.
+ */
+u64 state_migrate(struct prog_ctx *ctx, SolAccountInfo *state,
+		  const SolAccountInfo *main, u8 state_nonce, u8 main_nonce)
+{
+	u64 buf[MAYAN_STATE_SIZE / 8] = {0};
+	u8 *v2 = (u8 *)buf;
+	const u8 *v1 = state->data;
+	u8 val;
+	u64 result;
 
-	to_addr = vaa_mayan_to_addr_buf(mayan->msg2->data);
-	to_chain = vaa_mayan_to_chain(mayan->msg2->data);
+	if (!pubkey_same(state->owner, ctx->prog_id) ||
+	    state->data_len != MAYAN_STATE_V1_SIZE) {
+		mayan_error("not a v1 state");
+		return ERROR_INVALID_ACCOUNT_DATA;
+	}
 
-	market1 = vaa_mayan_market1(mayan->msg2->data);
-	market2 = vaa_mayan_market2(mayan->msg2->data);
+	val = mayan_v1_state(v1);
+	if (val != STATE_NOT_INITIALIZED) {
+		if (mayan_v1_bumps_v(v1) == MAYAN_STATE_V1_BUMPS) {
+			state_nonce = mayan_v1_state_nonce(v1);
+			main_nonce = mayan_v1_main_nonce(v1);
+		} else {
+			set_ctx_seed(ctx, mayan_v1_msg1(v1), mayan_v1_msg2(v1),
+				     &state_nonce, &main_nonce);
 
-	fee_swap = vaa_mayan_fee_swap(mayan->msg2->data);
-	fee_cancel = 0;
-	fee_return = vaa_mayan_fee_return(mayan->msg2->data);
+			result = ctx_check_seed_addr(ctx, state->key);
+			if (result != SUCCESS)
+				return result;
 
-	fee_swap = denormalize_amount(fee_swap, mayan->mint_from);
-	fee_cancel = denormalize_amount(fee_cancel, mayan->mint_from);
-	fee_return = denormalize_amount(fee_return, mayan->mint_to);
+			result = ctx_check_main_addr(ctx, main->key);
+			if (result != SUCCESS)
+				return result;
+		}
 
-	deadline = vaa_mayan_deadline(mayan->msg2->data);
+		mayan_data_set_version(v2, MAYAN_STATE_VERSION);
+		mayan_data_set_state(v2, val);
+		mayan_data_set_decimal(v2, mayan_v1_decimal(v1));
+		mayan_data_set_state_nonce(v2, state_nonce);
+		mayan_data_set_main_nonce(v2, main_nonce);
+		mayan_data_set_to_chain(v2, mayan_v1_to_chain(v1));
+		mayan_data_set_amount(v2, mayan_v1_amount(v1));
+
+		// done orders have their transfer sequence in the rate slot
+		if (val == STATE_DONE_SWAPPED || val == STATE_DONE_NOT_SWAPPED)
+			mayan_data_set_seq(v2, mayan_v1_seq(v1));
+		else
+			mayan_data_set_rate(v2, mayan_v1_rate(v1));
+
+		mayan_data_set_fee_swap(v2, mayan_v1_fee_swap(v1));
+		mayan_data_set_fee_cancel(v2, mayan_v1_fee_cancel(v1));
+		mayan_data_set_fee_return(v2, mayan_v1_fee_return(v1));
+		mayan_data_set_deadline(v2, mayan_v1_deadline(v1));
+		mayan_data_set_amount_min(v2, mayan_v1_amount_min(v1));
+		mayan_data_set_msg1(v2, mayan_v1_msg1(v1));
+		mayan_data_set_msg2(v2, mayan_v1_msg2(v1));
+		mayan_data_set_mint_from(v2, mayan_v1_mint_from(v1));
+		mayan_data_set_mint_to(v2, mayan_v1_mint_to(v1));
+		mayan_data_set_to_addr(v2, mayan_v1_to_addr(v1));
+		mayan_data_set_market1(v2, mayan_v1_market1(v1));
+		mayan_data_set_market2(v2, mayan_v1_market2(v1));
+	}
+
+	ctx_resize_account(state, MAYAN_STATE_SIZE);
+	layout_copy(state->data, v2, MAYAN_STATE_SIZE);
 
-	mayan_debug("> rate / decimals");
-	mayan_debug_64(rate, decimal, 0, 0, 0);
+	return SUCCESS;
+}
 
-	mayan_debug("setting state");
-	data = mayan->state->data;
-	data_ptr = data;
+/*
+  claims set the bit of the msg1 chain and sequence, so an order cannot be
+  claimed twice once its state is reused or closed. `once` fails on a set
+  bit. only the canonical page of 141 is taken, a second page of the same
+  sequences would clear every bit.
+ */
+u64 ledger_mark_claimed(const struct prog_ctx *ctx, SolAccountInfo *ledger,
+			u16 chain, u64 seq, bool once)
+{
+	u64 bit = seq % MAYAN_LEDGER_BITS;
+	SolPubkey addr;
+	u8 *bits;
+	u8 mask;
+
+	if (ledger->data_len != MAYAN_LEDGER_SIZE ||
+	    !pubkey_same(ledger->owner, ctx->prog_id) ||
+	    mayan_ledger_chain(ledger->data) != chain ||
+	    mayan_ledger_page(ledger->data) != seq / MAYAN_LEDGER_BITS) {
+		mayan_error("ledger page is wrong");
+		return ERROR_INVALID_ARGUMENT;
+	}
+
+	// the one page of chain and page: its header derives its address
+	const SolSignerSeed seeds[] = {
+		{.addr=ledger_seed, .len=SOL_ARRAY_SIZE(ledger_seed)},
+		{.addr=ledger->data + mayan_ledger_off_chain, .len=2},
+		{.addr=ledger->data + mayan_ledger_off_page, .len=8},
+		{.addr=ledger->data + mayan_ledger_off_bump, .len=1},
+	};
 
-	write_u8(data, &data_ptr, STATE_CLAIMED);
-	write_buffer(data, &data_ptr, msg1, 32);
-	write_buffer(data, &data_ptr, msg2, 32);
-	write_u64(data, &data_ptr, amount);
-	write_u8(data, &data_ptr, decimal);
-	write_u64(data, &data_ptr, rate);
-	write_buffer(data, &data_ptr, mint_from, 32);
-	write_buffer(data, &data_ptr, mint_to, 32);
-	write_buffer(data, &data_ptr, to_addr, 32);
-	write_u16(data, &data_ptr, to_chain);
+	if (sol_create_program_address(seeds, SOL_ARRAY_SIZE(seeds),
+				       ctx->prog_id, &addr) != SUCCESS ||
+	    !pubkey_same(&addr, ledger->key)) {
+		mayan_error("ledger page addr is wrong");
+		return ERROR_INVALID_ARGUMENT;
+	}
 
-	write_buffer(data, &data_ptr, market1, 32);
-	write_buffer(data, &data_ptr, market2, 32);
+	bits = ledger->data + MAYAN_LEDGER_HEADER_SIZE + bit / 8;
+	mask = 1 << (bit % 8);
+	if (once && (*bits & mask)) {
+		mayan_error("order is already claimed");
+		return ERROR_ACCOUNT_ALREADY_INITIALIZED;
+	}
 
-	write_u64(data, &data_ptr, fee_swap);
-	write_u64(data, &data_ptr, fee_cancel);
-	write_u64(data, &data_ptr, fee_return);
+	*bits |= mask;
+	return SUCCESS;
+}
 
-	write_u64(data, &data_ptr, deadline);
+/*
+  `state` is a done v2 state of msg1 funded by `payer`. the signer is
+  the payer or the relayer the state names. migrated states have no
+  payer and are never reclaimed. other program accounts (vault, ledger,
+  fresh slots) never match.
+ */
+u64 check_reclaim(const struct prog_ctx *ctx, const SolAccountInfo *state,
+		  const SolAccountInfo *msg1, const SolAccountInfo *signer,
+		  const SolAccountInfo *payer)
+{
+	const u8 *data = state->data;
+	u8 val;
 
-	write_u64(data, &data_ptr, amount_min); // state v1.1
+	if (!is_state_v2(ctx, state)) {
+		mayan_error("not a state");
+		return ERROR_INVALID_ACCOUNT_DATA;
+	}
 
-	if (!check_buffer_is_ok(data, data_ptr, MAYAN_STATE_TMP_SIZE)) {
-		return false;
+	val = mayan_data_state(data);
+	if (val != STATE_DONE_SWAPPED && val != STATE_DONE_NOT_SWAPPED) {
+		mayan_error("order is not done");
+		return ERROR_INVALID_ACCOUNT_DATA;
 	}
 
+	// the ledger bit comes from its header
+	if (wh_check_posted_vaa(ctx, msg1) != SUCCESS) {
+		mayan_error("msg1 is not a vaa");
+		return ERROR_INVALID_ACCOUNT_DATA;
+	}
 
-	return true;
+	if (!buf_pubkey_same(mayan_data_msg1(data), msg1->key)) {
+		mayan_error("msg1 is not the state's");
+		return ERROR_INVALID_ARGUMENT;
+	}
+
+	if (buf32_zero(mayan_data_payer(data)) ||
+	    !buf_pubkey_same(mayan_data_payer(data), payer->key)) {
+		mayan_error("payer is not the state's");
+		return ERROR_INVALID_ARGUMENT;
+	}
+
+	if (!signer->is_signer ||
+	    (!pubkey_same(signer->key, payer->key) &&
+	     (buf32_zero(mayan_data_relayer(data)) ||
+	      !buf_pubkey_same(mayan_data_relayer(data), signer->key)))) {
+		mayan_error("neither the payer nor its relayer signed");
+		return ERROR_MISSING_REQUIRED_SIGNATURES;
+	}
+
+	return SUCCESS;
 }
 
 static inline bool check_vault_mint(const SolAccountInfo *vault, const u8 *mint)
 {
-	SolPubkey tmp;
-	
 	if (vault->data_len < 32) {
 		mayan_error("vault data is small!");
 		return false;
 	}
 
-	sol_memcpy(&tmp, vault->data, 32);
-
-	if (!buf_pubkey_same(mint, &tmp)) {
+	if (!buf32_same(mint, vault->data)) {
 		mayan_error("mint is not same as vault!");
 		return false;
 	}
@@ -185,12 +457,14 @@ static inline bool check_vault_mint(const SolAccountInfo *vault, const u8 *mint)
 }
 
 
+// v1 states are migrated (147) first
 static inline u64 parse_state(SolAccountInfo *state, u8 *result)
 {
-	if (state->data_len < MAYAN_STATE_DATA_SIZE) {
-		mayan_error("state size is low");
-		mayan_debug_64(MAYAN_STATE_DATA_SIZE, state->data_len, 0, 0, 0);
-		return ERROR_ACCOUNT_DATA_TOO_SMALL;
+	if (state->data_len != MAYAN_STATE_SIZE ||
+	    mayan_data_version(state->data) != MAYAN_STATE_VERSION) {
+		mayan_error("state is not v2");
+		mayan_debug_64(MAYAN_STATE_SIZE, state->data_len, 0, 0, 0);
+		return ERROR_INVALID_ACCOUNT_DATA;
 	}
 
 	*result = mayan_data_state(state->data);
@@ -253,22 +527,51 @@ static inline bool check_simple_mints(struct swap_transitive_acc *swap)
 	return true;
 }
 
+/*
+  sets the signer seeds of an initialized state.
+
+  a v2 state is only trusted for being ours: program owned, v2 size and
+  version, written by claim or the migration. its bumps replace the
+  nonces of the instruction and no address is derived. without a build
+  time MAIN the main account is not checked either, a wrong one cannot
+  sign the CPIs that need it.
+ */
+u64 parse_state_seeds(struct prog_ctx *ctx, const SolAccountInfo *state,
+		      const SolAccountInfo *main, u8 *state_nonce,
+		      u8 *main_nonce)
+{
+	if (!is_state_v2(ctx, state)) {
+		mayan_error("state is not ours");
+		return ERROR_INCORRECT_PROGRAM_ID;
+	}
+
+	*state_nonce = mayan_data_state_nonce(state->data);
+	*main_nonce = mayan_data_main_nonce(state->data);
+
+	// set seed
+	set_ctx_seed(ctx, mayan_data_msg1(state->data),
+		     mayan_data_msg2(state->data), state_nonce, main_nonce);
+
+#ifdef BUILD_MAIN_KEY
+	// a compare, cheap enough to keep
+	return ctx_check_main_addr(ctx, main->key);
+#else
+	(void)main;
+	return SUCCESS;
+#endif
+}
+
 u64 parse_swap_x_accounts(struct prog_ctx *ctx,
 			  struct swap_transitive_acc *swap, bool transitive)
 {
 	u64 result;
-	bool is_ok;
-	const u8 *msg1_buf;
-	const u8 *msg2_buf;
-	const u8 *market1;
-	const u8 *market2;
 
 	u8 state;
 
 	mayan_debug("parse swap transitive accounts");
 
-	swap->state = ctx->cursor++;
-	swap->main = ctx->cursor++;
+	swap->state = ctx_next_account(ctx);
+	swap->main = ctx_next_account(ctx);
 	
 	swap->state_nonce = *ctx->data_ptr;
 	ctx->data_ptr++;
@@ -290,14 +593,17 @@ u64 parse_swap_x_accounts(struct prog_ctx *ctx,
 	}
 
 	swap->s_acc.main = swap->main->key;
-	swap->s_acc.from = ctx->cursor++;
-	swap->s_acc.to = ctx->cursor++;
+	swap->s_acc.from = ctx_next_account(ctx);
+	swap->s_acc.to = ctx_next_account(ctx);
 
 	if (transitive) {
-		swap->s_acc.tmp = ctx->cursor++;
+		swap->s_acc.tmp = ctx_next_account(ctx);
 	}
 
 	result = parse_state(swap->state, &state);
+	if (result != SUCCESS)
+		return result;
+
 	if (state != STATE_CLAIMED) {
 		mayan_error("state's state is wrong!");
 		mayan_debug_64(state, STATE_CLAIMED, 0, 0, 0);
@@ -305,32 +611,22 @@ u64 parse_swap_x_accounts(struct prog_ctx *ctx,
 	}
 
 
-	msg1_buf = mayan_data_msg1(swap->state->data);
-	msg2_buf = mayan_data_msg2(swap->state->data);
-
-	// TODO
-	// this duplicate code is bad. but hey
-	// it's the best I could at the moment.
-	// refactor later. --ise
+	result = parse_state_seeds(ctx, swap->state, swap->main,
+				   &swap->state_nonce, &swap->main_nonce);
+	if (result != SUCCESS)
+		return result;
 
-	// set seed
-	set_ctx_seed(ctx, msg1_buf, msg2_buf, &swap->state_nonce,
-		     &swap->main_nonce);
+	return validate_swap_x(ctx, swap, transitive);
+}
 
-	// validate seed account
-	result = ctx_check_seed_addr(ctx, swap->state->key);
-	if (result != SUCCESS) {
-		mayan_error("cannot validate seed addr");
-		return result;
-	}
+// markets and vault mints against the state
+u64 validate_swap_x(struct prog_ctx *ctx, struct swap_transitive_acc *swap,
+		    bool transitive)
+{
+	bool is_ok;
+	const u8 *market1;
+	const u8 *market2;
 
-	// validate main account
-	result = ctx_check_main_addr(ctx, swap->main->key);
-	if (result != SUCCESS) {
-		mayan_error("cannot validate main addr");
-		return result;
-	}
-		
 	// validate markets
 	market1 = mayan_data_market1(swap->state->data);
 	market2 = mayan_data_market2(swap->state->data);
@@ -363,6 +659,17 @@ u64 parse_swap_x_accounts(struct prog_ctx *ctx,
 		return ERROR_CUSTOM_ZERO;
 	}
 
+	// settles move the whole free balance of the shared open orders, so
+	// only into MAIN's wallets, where the sweep would put it
+	if (swap->direct &&
+	    (!spl_owner_is(ctx, swap->s_acc.from, swap->main->key) ||
+	     !spl_owner_is(ctx, swap->s_acc.to, swap->main->key) ||
+	     (transitive &&
+	      !spl_owner_is(ctx, swap->s_acc.tmp, swap->main->key)))) {
+		mayan_error("wallets are not main's");
+		return ERROR_INVALID_ARGUMENT;
+	}
+
 	return SUCCESS;
 }
 
@@ -380,8 +687,8 @@ u64 parse_swap_transitive_accounts(struct prog_ctx *ctx,
 
 	mayan_debug("parse swap transitive accounts");
 
-	swap->state = ctx->cursor++;
-	swap->main = ctx->cursor++;
+	swap->state = ctx_next_account(ctx);
+	swap->main = ctx_next_account(ctx);
 	
 	swap->state_nonce = *ctx->data_ptr;
 	ctx->data_ptr++;
@@ -401,11 +708,14 @@ u64 parse_swap_transitive_accounts(struct prog_ctx *ctx,
 	}
 
 	swap->s_acc.main = swap->main->key;
-	swap->s_acc.from = ctx->cursor++;
-	swap->s_acc.to = ctx->cursor++;
-	swap->s_acc.tmp = ctx->cursor++;
+	swap->s_acc.from = ctx_next_account(ctx);
+	swap->s_acc.to = ctx_next_account(ctx);
+	swap->s_acc.tmp = ctx_next_account(ctx);
 
 	result = parse_state(swap->state, &state);
+	if (result != SUCCESS)
+		return result;
+
 	if (state != STATE_CLAIMED) {
 		mayan_error("state's state is wrong!");
 		mayan_debug_64(state, STATE_CLAIMED, 0, 0, 0);
@@ -469,23 +779,16 @@ u64 parse_swap_transitive_accounts(struct prog_ctx *ctx,
 }
 
 u64 parse_transfer_accounts(struct prog_ctx *ctx, struct transfer_acc *trn,
-			    bool is_wrapped)
+			    bool is_wrapped, bool fee_vault)
 {
-	const u8 *msg1_buf;
-	const u8 *msg2_buf;
-	const u8 *mint_from;
-	const u8 *mint_to;
-	const u8 *mint_ref;
-
-	u64 rfee;
 	u64 result;
 	u8 state;
 
 	mayan_debug("parse trn accounts");
 
-	trn->owner = ctx->cursor++;
-	trn->state = ctx->cursor++;
-	trn->main = ctx->cursor++;
+	trn->owner = ctx_next_account(ctx);
+	trn->state = ctx_next_account(ctx);
+	trn->main = ctx_next_account(ctx);
 	
 	trn->state_nonce = *ctx->data_ptr;
 	ctx->data_ptr++;
@@ -503,8 +806,19 @@ u64 parse_transfer_accounts(struct prog_ctx *ctx, struct transfer_acc *trn,
 		return result;
 	}
 
+	trn->fee_vault = NULL;
+	if (fee_vault) {
+		trn->fee_vault = ctx_next_account(ctx);
+		if (!is_fee_vault(ctx, trn->fee_vault)) {
+			mayan_error("fee vault is wrong");
+			return ERROR_INVALID_ARGUMENT;
+		}
+	}
+
 	mayan_debug("account checks");
 	result = parse_state(trn->state, &state);
+	if (result != SUCCESS)
+		return result;
 
 	if (state != STATE_SWAP_DONE && state != STATE_CLAIMED) {
 		mayan_error("state's state is wrong!");
@@ -512,6 +826,22 @@ u64 parse_transfer_accounts(struct prog_ctx *ctx, struct transfer_acc *trn,
 		return ERROR_INVALID_ACCOUNT_DATA;
 	}
 
+	result = parse_state_seeds(ctx, trn->state, trn->main,
+				   &trn->state_nonce, &trn->main_nonce);
+	if (result != SUCCESS)
+		return result;
+
+	return validate_transfer(trn, state);
+}
+
+// mint against the state, fills the wormhole transfer from the state
+u64 validate_transfer(struct transfer_acc *trn, u8 state)
+{
+	const u8 *mint_from;
+	const u8 *mint_to;
+	const u8 *mint_ref;
+	u64 rfee;
+
 	trn->try_cancel = false;
 	if (state != STATE_SWAP_DONE) {
 		trn->try_cancel = true;
@@ -520,27 +850,6 @@ u64 parse_transfer_accounts(struct prog_ctx *ctx, struct transfer_acc *trn,
 	trn->transfer.owner = trn->main->key;
 	trn->transfer.payer = trn->owner->key;
 
-	msg1_buf = mayan_data_msg1(trn->state->data);
-	msg2_buf = mayan_data_msg2(trn->state->data);
-
-	// set seed
-	set_ctx_seed(ctx, msg1_buf, msg2_buf, &trn->state_nonce,
-		     &trn->main_nonce);
-
-	// validate seed account
-	result = ctx_check_seed_addr(ctx, trn->state->key);
-	if (result != SUCCESS) {
-		mayan_error("cannot validate seed addr");
-		return result;
-	}
-
-	// validate main account
-	result = ctx_check_main_addr(ctx, trn->main->key);
-	if (result != SUCCESS) {
-		mayan_error("cannot validate main addr");
-		return result;
-	}
-
 	// validate mint
 	mint_from = mayan_data_mint_from(trn->state->data);
 	mint_to = mayan_data_mint_to(trn->state->data);
@@ -550,10 +859,10 @@ u64 parse_transfer_accounts(struct prog_ctx *ctx, struct transfer_acc *trn,
 		mayan_error("mint is not correct!");
 		mayan_debug_64(0, state, STATE_SWAP_DONE,
 			       state == STATE_SWAP_DONE, 0);
-		mayan_log_buf_32(mint_from);
-		mayan_log_buf_32(mint_to);
-		mayan_log_buf_32(mint_ref);
-		mayan_log_buf_32(trn->transfer.mint->key->x);
+		mayan_debug_buf_32(mint_from);
+		mayan_debug_buf_32(mint_to);
+		mayan_debug_buf_32(mint_ref);
+		mayan_debug_buf_32(trn->transfer.mint->key->x);
 
 		return ERROR_CUSTOM_ZERO;
 	}
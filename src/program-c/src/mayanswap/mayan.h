@@ -18,133 +18,149 @@ enum mayan_state {
 	STATE_DONE_NOT_SWAPPED,
 };
 
-#define MAYAN_STATE_DATA_SIZE 284
-
-static inline void mayan_data_set_state(u8 *data, u8 state)
+// ours, written by a claim or the migration
+static inline bool is_state_v2(const struct prog_ctx *ctx,
+			       const SolAccountInfo *state)
 {
-	data[0] = state;
+	return state->data_len == MAYAN_STATE_SIZE &&
+	       mayan_data_version(state->data) == MAYAN_STATE_VERSION &&
+	       pubkey_same(state->owner, ctx->prog_id);
 }
 
-static inline void mayan_data_set_amount(u8 *data, u64 amount)
-{
-	*(u64 *)(data + 65) = amount;
-}
+struct claim_acc {
+	SolAccountInfo *owner;
+	SolAccountInfo *msg1;
+	SolAccountInfo *msg2;
+	SolAccountInfo *final;
+	SolAccountInfo *state;
+	SolAccountInfo *main;
 
-static inline void mayan_data_set_seq(u8 *data, u64 seq)
-{
-	*(u64 *)(data + 74) = seq;
-}
+	SolAccountInfo *mint_from;
+	SolAccountInfo *mint_to;
 
-static inline u8 mayan_data_state(const u8 *data)
-{
-	return data[0];
-}
+	struct mayan_vaa_view vaa; // msg1 and msg2
 
-static inline const u8 *mayan_data_msg1(const u8 *data)
-{
-	return data + 1;
-}
+	u8 final_nonce;
+	u8 state_nonce;
+	u8 main_nonce;
+	u8 mint_from_nonce;
+	u8 mint_to_nonce;
 
-static inline const u8 *mayan_data_msg2(const u8 *data)
-{
-	return data + 33;
-}
+	u8 state_val;
+};
 
-static inline const u8 *mayan_data_mint_from(const u8 *data)
-{
-	return data + 82;
-}
+bool mayan_init_state(struct prog_ctx *ctx, struct claim_acc *mayan);
+bool mayan_write_state(struct claim_acc *mayan);
 
-static inline const u8 *mayan_data_mint_to(const u8 *data)
-{
-	return data + 114;
-}
+static const u8 final_seed[] = {'V', '3', 'S', 'T', 'A', 'T', 'E', 'f'};
 
-static inline const u8 *mayan_data_to_addr(const u8 *data)
+/*
+  program accounts that are not orders: fee vault (140), claim ledger
+  pages (141), state slots (142) and mint registries (145). they are told
+  apart by their size, so the instructions using them check the owner and
+  the size instead of deriving the address. ledger pages are derived too,
+  from the chain, page and bump of their header.
+ */
+static const u8 fee_vault_seed[] = {'F', 'E', 'E', 'S'};
+static const u8 ledger_seed[] = {'L', 'E', 'D', 'G', 'E', 'R'};
+static const u8 slot_seed[] = {'S', 'L', 'O', 'T'};
+static const u8 mints_seed[] = {'M', 'I', 'N', 'T', 'S'};
+
+/*
+  open orders pool: one MAIN owned open orders per market (143), owned by
+  the dex. direct swaps leave their fills in it, a sweep (144) settles
+  them to the MAIN wallets of the market.
+ */
+static const u8 open_orders_seed[] = {'O', 'P', 'E', 'N'};
+
+// `seeds` (up to 4) sign instead of the state seeds
+static inline void set_ctx_pda_seed(struct prog_ctx *ctx,
+				    const SolSignerSeed *seeds, u64 len)
 {
-	return data + 146;
+	for (u64 i = 0; i < len; ++i)
+		ctx->state_seed[i] = seeds[i];
+	ctx->seeds[0].len = len;
 }
 
-static inline const u16 mayan_data_to_chain(const u8 *data)
+// empty, fees are plain system transfers to it
+static inline bool is_fee_vault(const struct prog_ctx *ctx,
+				const SolAccountInfo *vault)
 {
-	return *(u16 *)(data + 178);
+	return vault->data_len == 0 && pubkey_same(vault->owner, ctx->prog_id);
 }
 
-static inline const u8 *mayan_data_market1(const u8 *data)
+/*
+  a slot is a state account that is claimed into instead of creating
+  one. it is free while it has no order (fresh) or its order is done,
+  finished state PDAs are slots too. fresh slots carry the version.
+ */
+static inline bool is_free_slot(const struct prog_ctx *ctx,
+				const SolAccountInfo *slot)
 {
-	return data + 180;
-}
+	u8 state;
 
-static inline const u8 *mayan_data_market2(const u8 *data)
-{
-	return data + 212;
-}
+	if (!is_state_v2(ctx, slot))
+		return false;
 
-static inline u64 mayan_data_amount(const u8 *data)
-{
-	return *(u64 *)(data + 65);
+	state = mayan_data_state(slot->data);
+	return state == STATE_NOT_INITIALIZED || state == STATE_DONE_SWAPPED ||
+	       state == STATE_DONE_NOT_SWAPPED;
 }
 
-static inline u64 mayan_data_rate(const u8 *data)
+static inline bool is_mint_registry(const struct prog_ctx *ctx,
+				    const SolAccountInfo *acc)
 {
-	return *(u64 *)(data + 74);
+	return acc->data_len == MAYAN_MINTS_SIZE &&
+	       pubkey_same(acc->owner, ctx->prog_id);
 }
 
-static inline u8 mayan_data_decimal(const u8 *data)
-{
-	return *(data + 73);
-}
+u64 mints_add(struct prog_ctx *ctx, SolAccountInfo *registry,
+	      const SolAccountInfo *mint, const SolAccountInfo *authority,
+	      u16 chain, const u8 *tkn_addr);
 
-static inline u64 mayan_data_fee_swap(const u8 *data)
-{
-	return *(u64 *)(data + 244);
-}
+u64 state_migrate(struct prog_ctx *ctx, SolAccountInfo *state,
+		  const SolAccountInfo *main, u8 state_nonce, u8 main_nonce);
 
-static inline u64 mayan_data_fee_cancel(const u8 *data)
-{
-	return *(u64 *)(data + 252);
-}
+u64 ledger_mark_claimed(const struct prog_ctx *ctx, SolAccountInfo *ledger,
+			u16 chain, u64 seq, bool once);
 
-static inline u64 mayan_data_fee_return(const u8 *data)
-{
-	return *(u64 *)(data + 260);
-}
+u64 check_reclaim(const struct prog_ctx *ctx, const SolAccountInfo *state,
+		  const SolAccountInfo *msg1, const SolAccountInfo *signer,
+		  const SolAccountInfo *payer);
 
-static inline u64 mayan_data_deadline(const u8 *data)
-{
-	return *(u64 *)(data + 268);
-}
+bool validate_mint_accounts(struct prog_ctx *ctx,
+			    const struct claim_acc *mayan,
+			    const SolAccountInfo *registry);
+bool validate_mint_to(struct prog_ctx *ctx, const struct claim_acc *mayan,
+		      const SolAccountInfo *registry);
 
-static inline u64 mayan_data_amount_min(const u8 *data)
+static inline u64 check_final_addr(const struct prog_ctx *ctx,
+				   const SolPubkey *final, const u8 *msg1_buf,
+				   const u8 *msg2_buf, const u8 *nonce)
 {
-	return *(u64 *)(data + 276);
-}
-
-struct claim_acc {
-	SolAccountInfo *owner;
-	SolAccountInfo *msg1;
-	SolAccountInfo *msg2;
-	SolAccountInfo *final;
-	SolAccountInfo *state;
-	SolAccountInfo *main;
-
-	SolAccountInfo *mint_from;
-	SolAccountInfo *mint_to;
-
-	u8 final_nonce;
-	u8 state_nonce;
-	u8 main_nonce;
-	u8 mint_from_nonce;
-	u8 mint_to_nonce;
-
-	u8 state_val;
-};
+	const SolSignerSeed fseeds[] = {
+		{.addr=final_seed, .len=SOL_ARRAY_SIZE(final_seed)},
+		{.addr=msg1_buf, .len=32},
+		{.addr=msg2_buf, .len=32},
+		{.addr=nonce, .len=1},
+	};
+	SolPubkey tmp;
+	u64 result;
 
-bool mayan_init_state(struct prog_ctx *ctx, struct claim_acc *mayan);
+	result = sol_create_program_address(fseeds, SOL_ARRAY_SIZE(fseeds),
+					    ctx->prog_id, &tmp);
+	if (result != SUCCESS) {
+		mayan_error("cannot create final addr");
+		return result;
+	}
 
-static const u8 final_seed[] = {'V', '3', 'S', 'T', 'A', 'T', 'E', 'f'};
+	if (!pubkey_same(&tmp, final)) {
+		mayan_error("final addr is wrong");
+		return ERROR_CUSTOM_ZERO;
+	}
 
-bool validate_mint_accounts(struct prog_ctx *ctx, struct claim_acc *mayan);
+	return SUCCESS;
+}
 
 static inline u64 parse_claim_accounts(struct prog_ctx *ctx,
 				       struct claim_acc *mayan)
@@ -155,15 +171,15 @@ static inline u64 parse_claim_accounts(struct prog_ctx *ctx,
 
 
 	mayan_debug("parse mayan account");
-	mayan->owner = ctx->cursor++;
-	mayan->msg1 = ctx->cursor++;
-	mayan->msg2 = ctx->cursor++;
-	mayan->final = ctx->cursor++;
-	mayan->state = ctx->cursor++;
-	mayan->main = ctx->cursor++;
+	mayan->owner = ctx_next_account(ctx);
+	mayan->msg1 = ctx_next_account(ctx);
+	mayan->msg2 = ctx_next_account(ctx);
+	mayan->final = ctx_next_account(ctx);
+	mayan->state = ctx_next_account(ctx);
+	mayan->main = ctx_next_account(ctx);
 
-	mayan->mint_from = ctx->cursor++;
-	mayan->mint_to = ctx->cursor++;
+	mayan->mint_from = ctx_next_account(ctx);
+	mayan->mint_to = ctx_next_account(ctx);
 
 	mayan->final_nonce = *ctx->data_ptr;
 	ctx->data_ptr++;
@@ -195,6 +211,13 @@ static inline u64 parse_claim_accounts(struct prog_ctx *ctx,
 		return ERROR_ACCOUNT_ALREADY_INITIALIZED;
 	}
 
+	if (!mayan_vaa_decode(&mayan->vaa, mayan->msg1->data,
+			      mayan->msg1->data_len, mayan->msg2->data,
+			      mayan->msg2->data_len)) {
+		mayan_error("msg data len");
+		return ERROR_ACCOUNT_DATA_TOO_SMALL;
+	}
+
 	msg1_buf = (u8 *)mayan->msg1->key;
 	msg2_buf = (u8 *)mayan->msg2->key;
 
@@ -216,31 +239,76 @@ static inline u64 parse_claim_accounts(struct prog_ctx *ctx,
 		return result;
 	}
 
-	// validate mint accounts
-	if (!validate_mint_accounts(ctx, mayan)) {
-		mayan_error("mints are bad");
-		return ERROR_CUSTOM_ZERO;
+	return check_final_addr(ctx, mayan->final->key, msg1_buf, msg2_buf,
+				&mayan->final_nonce);
+}
+
+/*
+  a single vaa order: msg is msg1 and msg2 of a pair, so its state is
+  ["V2STATE", msg, msg, nonce] and every instruction after the claim
+  works on it unchanged (close takes msg twice). no final,
+  the redeem fails on a claimed transfer.
+ */
+static inline u64 parse_claim_single_accounts(struct prog_ctx *ctx,
+					      struct claim_acc *mayan)
+{
+	u64 result;
+	u8 *msg_buf;
+
+	mayan_debug("parse mayan single account");
+	mayan->owner = ctx_next_account(ctx);
+	mayan->msg1 = ctx_next_account(ctx);
+	mayan->msg2 = mayan->msg1;
+	mayan->final = NULL;
+	mayan->state = ctx_next_account(ctx);
+	mayan->main = ctx_next_account(ctx);
+
+	mayan->mint_from = ctx_next_account(ctx);
+	mayan->mint_to = ctx_next_account(ctx);
+
+	mayan->final_nonce = 0;
+	mayan->state_nonce = *ctx->data_ptr;
+	ctx->data_ptr++;
+	mayan->main_nonce = *ctx->data_ptr;
+	ctx->data_ptr++;
+
+	// the token bridge checks the `from` mint of its transfer
+	mayan->mint_from_nonce = 0;
+	mayan->mint_to_nonce = *ctx->data_ptr;
+	ctx->data_ptr++;
+
+	if (!mayan->owner->is_signer) {
+		mayan_error("owner is not signer");
+		return ERROR_MISSING_REQUIRED_SIGNATURES;
 	}
 
-	// TODO clean this section up
-	// this is really bad. but whatever
-	const SolSignerSeed fseeds[] = {
-		{.addr=final_seed, .len=SOL_ARRAY_SIZE(final_seed)},
-		{.addr=msg1_buf, .len=32},
-		{.addr=msg2_buf, .len=32},
-		{.addr=&mayan->final_nonce, .len=1},
-	};
-	SolPubkey tmp;
-	result = sol_create_program_address(fseeds, SOL_ARRAY_SIZE(fseeds), ctx->prog_id,
-				   &tmp);
+	ctx->payer = mayan->owner->key;
+
+	if (mayan->state->data_len != 0) {
+		mayan_error("account already initialized");
+		return ERROR_ACCOUNT_ALREADY_INITIALIZED;
+	}
+
+	if (!mayan_vaa_decode_single(&mayan->vaa, mayan->msg1->data,
+				     mayan->msg1->data_len)) {
+		mayan_error("msg data len");
+		return ERROR_ACCOUNT_DATA_TOO_SMALL;
+	}
+
+	msg_buf = (u8 *)mayan->msg1->key;
+	set_ctx_seed(ctx, msg_buf, msg_buf, &mayan->state_nonce,
+		     &mayan->main_nonce);
+
+	result = ctx_check_seed_addr(ctx, mayan->state->key);
 	if (result != SUCCESS) {
-		mayan_error("cannot create final addr");
+		mayan_error("cannot validate seed addr");
 		return result;
 	}
 
-	if (!SolPubkey_same(&tmp, mayan->final->key)) {
-		mayan_error("final addr is wrong");
-		return ERROR_CUSTOM_ZERO;
+	result = ctx_check_main_addr(ctx, mayan->main->key);
+	if (result != SUCCESS) {
+		mayan_error("cannot validate main addr");
+		return result;
 	}
 
 	return SUCCESS;
@@ -263,9 +331,9 @@ static inline u64 parse_close_accounts(struct prog_ctx *ctx,
 	u8* msg1_buf;
 	u8* msg2_buf;
 
-	close->msg1 = ctx->cursor++;
-	close->msg2 = ctx->cursor++;
-	close->state = ctx->cursor++;
+	close->msg1 = ctx_next_account(ctx);
+	close->msg2 = ctx_next_account(ctx);
+	close->state = ctx_next_account(ctx);
 		
 	close->state_nonce = *ctx->data_ptr;
 	ctx->data_ptr++;
@@ -289,6 +357,10 @@ static inline u64 parse_close_accounts(struct prog_ctx *ctx,
 	return SUCCESS;
 }
 
+u64 parse_state_seeds(struct prog_ctx *ctx, const SolAccountInfo *state,
+		      const SolAccountInfo *main, u8 *state_nonce,
+		      u8 *main_nonce);
+
 struct swap_transitive_acc {
 	SolAccountInfo *state;
 	SolAccountInfo *main;
@@ -301,15 +373,20 @@ struct swap_transitive_acc {
 	u8 main_nonce;
 
 	u8 side; // only in simple
+	bool direct; // dex orders instead of the swap program
+	bool settle; // direct: settle the fill now, not at the next sweep
 };
 
 u64 parse_swap_x_accounts(struct prog_ctx *ctx,
                           struct swap_transitive_acc *swap, bool transitive);
+u64 validate_swap_x(struct prog_ctx *ctx, struct swap_transitive_acc *swap,
+		    bool transitive);
 
 struct transfer_acc {
 	SolAccountInfo *owner;
 	SolAccountInfo *state;
 	SolAccountInfo *main;
+	SolAccountInfo *fee_vault; // NULL: the owner pays the message fee
 
 	struct wh_transfer_acc transfer;
 
@@ -321,6 +398,7 @@ struct transfer_acc {
 };
 
 u64 parse_transfer_accounts(struct prog_ctx *ctx, struct transfer_acc *trn,
-			    bool is_wrapped);
+			    bool is_wrapped, bool fee_vault);
+u64 validate_transfer(struct transfer_acc *trn, u8 state);
 
 #endif // _MAYAN_H_
@@ -1,4 +1,5 @@
 #include "dex.h"
+#include "event.h"
 #include "sol/entrypoint.h"
 #include "sol/pubkey.h"
 #include "sol/types.h"
@@ -6,14 +7,57 @@
 #include "wormhole.h"
 #include <solana_sdk.h>
 
-#define DEBUG_FLAG
-#define OVERFLOW_FLAG
-
+#include "chains.h"
 #include "ctx.h"
 #include "utils.h"
 #include "mayan.h"
 #include "build-info.h"
 
+/*
+  account slots per instruction: the parsed accounts plus the programs
+  and sysvars their CPIs reference. accounts past these are never decoded.
+ */
+#define CLOSE_KA_NUM 4
+#define CLAIM_KA_NUM 14
+#define CLAIM_SINGLE_KA_NUM 18
+#define SWAP_SIMPLE_KA_NUM 20
+#define SWAP_TRANSITIVE_KA_NUM 32
+#define TRANSFER_KA_NUM 24
+#define INIT_PDA_KA_NUM 3
+#define INIT_OPEN_ORDERS_KA_NUM 7
+#define SWEEP_KA_NUM 14
+#define REGISTER_MINT_KA_NUM 3
+
+/*
+  atomic: claim (8) and proof (3) accounts, one market (9) or two and
+  the tmp wallet (19), from and to wallets, native transfer (11), rent,
+  clock and the programs system, spl, wormhole, token bridge, dex, swap.
+ */
+#define ATOMIC_FIXED_KA_NUM (8 + 3 + 2 + 11 + 2 + 6)
+#define ATOMIC_SIMPLE_KA_NUM (ATOMIC_FIXED_KA_NUM + 9)
+#define ATOMIC_TRANSITIVE_KA_NUM (ATOMIC_FIXED_KA_NUM + 2 * 9 + 1)
+
+// states per migration, funder and MAIN first, system program last
+#define MIGRATE_BATCH_MAX 16
+#define MIGRATE_KA_NUM (3 + MIGRATE_BATCH_MAX)
+
+// orders per reclaim: state, msg1, ledger page, payer
+#define RECLAIM_BATCH_MAX 8
+#define RECLAIM_ORDER_KA_NUM 4
+#define RECLAIM_KA_NUM (1 + RECLAIM_BATCH_MAX * RECLAIM_ORDER_KA_NUM)
+
+/*
+  pairs per batch claim, bounded by the accounts array on the stack:
+  every pair adds CLAIM_PAIR_KA_NUM account infos (56 bytes) to the frame
+  of mayan_claim_batch: claim (8), proof (3) and slot. the array stays
+  under 3 KiB of the 4 KiB bpf frame, the claim structs take the rest.
+ */
+#define CLAIM_BATCH_MAX 4
+#define CLAIM_PAIR_KA_NUM 12
+#define CLAIM_BATCH_KA_NUM (CLAIM_BATCH_MAX * CLAIM_PAIR_KA_NUM)
+_Static_assert(CLAIM_BATCH_KA_NUM * sizeof(SolAccountInfo) <= 3072,
+	       "batch claim accounts do not fit the frame");
+
 static inline u8 read_u8(struct prog_ctx *ctx)
 {
 	u8 res;
@@ -35,16 +79,15 @@ static inline u64 check_cursors(struct prog_ctx *ctx)
 	mayan_debug_64((u64)ctx->data_ptr, (u64)ctx->params->data,
 		       ctx->data_ptr - ctx->params->data, 0,
 		       ctx->params->data_len);
-	mayan_debug_64((u64)(ctx->cursor), (u64)(ctx->params->ka),
-		       ctx->cursor - ctx->params->ka, 0, ctx->params->ka_num);
+	mayan_debug_64(ctx->params->ka_num, ctx->cursor.left,
+		       ctx->cursor.cap, 0, ctx->cursor.overflow);
 
-	// TODO check cursor
 	if ((ctx->data_ptr - ctx->params->data) > ctx->params->data_len) {
 		mayan_error("not enough arg");
 		return ERROR_INVALID_ARGUMENT;
 	}
 
-	if ((ctx->cursor - ctx->params->ka) > ctx->params->ka_num) {
+	if (ctx->cursor.overflow) {
 		mayan_error("not enough accounts");
 		return ERROR_NOT_ENOUGH_ACCOUNT_KEYS;
 	}
@@ -52,32 +95,31 @@ static inline u64 check_cursors(struct prog_ctx *ctx)
 	return SUCCESS;
 }
 
-static inline u64 validate_vaas(const SolAccountInfo *msg1,
-				const SolAccountInfo *msg2)
+static inline u64 validate_vaas(const struct mayan_vaa_view *vaa)
 {
 	u64 result;
 
 	mayan_debug("check vaa pair");
-	result = check_vaa_pair(msg1, msg2);
+	result = check_vaa_pair(vaa);
 	if (result != SUCCESS)
 		return result;
 
-	if (!is_emitter_token_bridge(msg1->data)) {
+	if (!is_emitter_token_bridge(vaa)) {
 		mayan_error("msg1 is not from token bridge");
 		return ERROR_INVALID_ACCOUNT_DATA;
 	}
 
-	if (!is_emitter_mayan_bridge(msg2->data)) {
+	if (!is_emitter_mayan_bridge(vaa)) {
 		mayan_error("msg2 is not from mayan bridge");
 		return ERROR_INVALID_ACCOUNT_DATA;
 	}
 
-	if (vaa_payload_id(msg1->data) != 1) {
+	if (vaa->payload1 != 1) {
 		mayan_error("msg1 is not transfer token");
 		return ERROR_INVALID_ACCOUNT_DATA;
 	}
 
-	if (vaa_payload_id(msg2->data) != 1) {
+	if (vaa->payload2 != 1) {
 		mayan_error("msg2 is not swap token");
 		return ERROR_INVALID_ACCOUNT_DATA;
 	}
@@ -85,116 +127,311 @@ static inline u64 validate_vaas(const SolAccountInfo *msg1,
 }
 
 
-static u64 mayan_claim(struct prog_ctx *ctx)
-{
-	struct claim_acc mayan;
+struct claim_proof {
 	SolAccountInfo *claim;
-	u64 result;
-	u8 nonce1;
-	u8 nonce2;
+	SolAccountInfo *ledger;
+	SolAccountInfo *mints; // any account when there is no registry
+
 	u8 claim_nonce;
-	const u8* hash1;
-	const u8* hash2;
+};
 
-	mayan_debug("mayan claim");
+static inline void parse_claim_proof(struct prog_ctx *ctx,
+				     struct claim_proof *proof)
+{
+	proof->claim = ctx_next_account(ctx);
+	proof->claim_nonce = read_u8(ctx);
+	proof->ledger = ctx_next_account(ctx);
+	proof->mints = ctx_next_account(ctx);
+}
 
-	result = parse_claim_accounts(ctx, &mayan);
+static u64 check_claim(struct prog_ctx *ctx, const struct claim_acc *mayan,
+		       const struct claim_proof *proof)
+{
+	u64 result;
+
+	mayan_debug(" >> msg1");
+	result = wh_check_posted_vaa(ctx, mayan->msg1);
 	if (result != SUCCESS)
 		return result;
 
-	nonce1 = read_u8(ctx);
-	nonce2 = read_u8(ctx);
-	hash1 = read_buffer(ctx, 32);
-	hash2 = read_buffer(ctx, 32);
-
-	claim = ctx->cursor++;
-	claim_nonce = read_u8(ctx);
-
-	result = parse_rent_account(ctx, &ctx->rent);
+	mayan_debug(" >> msg2");
+	result = wh_check_posted_vaa(ctx, mayan->msg2);
 	if (result != SUCCESS)
 		return result;
 
-	// check cursor
-	result = check_cursors(ctx);
+	mayan_debug("checks");
+	result = validate_vaas(&mayan->vaa);
 	if (result != SUCCESS)
 		return result;
-	
-	mayan_debug("checks");
-	result = validate_vaas(mayan.msg1, mayan.msg2);
+
+	if (!validate_mint_accounts(ctx, mayan, proof->mints)) {
+		mayan_error("mints are bad");
+		return ERROR_CUSTOM_ZERO;
+	}
+
+	// the claim flag says nothing of which transfer, the address does
+	result = wh_check_claimed(ctx, &mayan->vaa, proof->claim_nonce,
+				  proof->claim);
 	if (result != SUCCESS)
 		return result;
 
-	mayan_debug(" >> msg1");
-	result = wh_check_msg_addr(ctx, mayan.msg1->key, nonce1, hash1);
+	return ledger_mark_claimed(ctx, proof->ledger, mayan->vaa.chain,
+				   mayan->vaa.seq, true);
+}
+
+/*
+  writes the order into a free slot in place. the slot pool is kept by
+  the relayer, nothing on chain lists the free slots: any v2 state with
+  no order or a done one is free. the slot's address says nothing of the
+  order, the order is found by its msg1 and the stored nonces are the
+  ones of its V2STATE address.
+ */
+static u64 claim_to_slot(struct prog_ctx *ctx, struct claim_acc *mayan,
+			 SolAccountInfo *slot)
+{
+	if (!is_free_slot(ctx, slot)) {
+		mayan_error("slot is not free");
+		return ERROR_ACCOUNT_ALREADY_INITIALIZED;
+	}
+
+	mayan->state = slot;
+	if (!mayan_write_state(mayan)) {
+		mayan_error("cannot write state");
+		return ERROR_CUSTOM_ZERO;
+	}
+
+	return SUCCESS;
+}
+
+/*
+  claims into a new state PDA, or into a free slot (102, the slot comes
+  after the mint registry) without creating an account. the state PDA is
+  still checked to be empty: orders claimed before the ledger are only
+  in it.
+ */
+static noinline u64 mayan_claim(struct prog_ctx *ctx, bool to_slot)
+{
+	SolAccountInfo accounts[CLAIM_KA_NUM];
+	struct claim_acc mayan;
+	struct claim_proof proof;
+	SolAccountInfo *slot = NULL;
+	u64 result;
+
+	mayan_debug("mayan claim");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+
+	result = parse_claim_accounts(ctx, &mayan);
 	if (result != SUCCESS)
 		return result;
-	
-	mayan_debug(" >> msg2");
-	result = wh_check_msg_addr(ctx, mayan.msg2->key, nonce2, hash2);
+
+	parse_claim_proof(ctx, &proof);
+
+	if (to_slot) {
+		slot = ctx_next_account(ctx);
+	} else {
+		result = ctx_load_rent(ctx);
+		if (result != SUCCESS)
+			return result;
+	}
+
+	// check cursor
+	result = check_cursors(ctx);
 	if (result != SUCCESS)
 		return result;
 	
-	result = wh_check_claimed(ctx, mayan.msg1, claim_nonce, claim);
+	result = check_claim(ctx, &mayan, &proof);
 	if (result != SUCCESS)
 		return result;
 
 	mayan_debug("let's claim");
-	if (!mayan_init_state(ctx, &mayan)) {
+	if (to_slot) {
+		result = claim_to_slot(ctx, &mayan, slot);
+		if (result != SUCCESS)
+			return result;
+	} else if (!mayan_init_state(ctx, &mayan)) {
 		mayan_error("cannot initialize state");
 		return ERROR_CUSTOM_ZERO;
 	}
 
+	mayan_emit_claimed(mayan.state->data);
+
 	return SUCCESS;
 }
 
-static u64 mayan_swap_x(struct prog_ctx *ctx, bool transitive)
+// a transfer with payload from the mayan bridge, redeemed by MAIN
+static inline u64 validate_vaa_single(const struct mayan_vaa_view *vaa,
+				      const SolPubkey *main)
 {
-	struct swap_transitive_acc swap = {0};
+	if (!is_emitter_token_bridge(vaa)) {
+		mayan_error("msg is not from token bridge");
+		return ERROR_INVALID_ACCOUNT_DATA;
+	}
 
-	u64 result;
+	if (!is_emitter_mayan_bridge(vaa)) {
+		mayan_error("msg is not sent by mayan bridge");
+		return ERROR_INVALID_ACCOUNT_DATA;
+	}
 
-	u64 before;
-	u64 after;
-	u64 diff;
-	
-	u64 amount = 0;
-	u64 amount_min = 0;
-	u64 fee = 0;
-	u64 rate = 0;
-	u8 decimal = 0;
+	if (vaa->payload1 != 3) {
+		mayan_error("msg is not transfer with payload");
+		return ERROR_INVALID_ACCOUNT_DATA;
+	}
 
-	if (transitive) {
-		mayan_debug("mayan swap transitive");
-	} else {
-		mayan_debug("mayan swap simple");
+	if (vaa->redeemer_chain != CHAIN_ID_SOLANA ||
+	    !buf_pubkey_same(vaa->redeemer, main)) {
+		mayan_error("msg is not redeemed by main");
+		return ERROR_INVALID_ACCOUNT_DATA;
 	}
 
-	result = parse_swap_x_accounts(ctx, &swap, transitive);
+	return SUCCESS;
+}
+
+/*
+  claims a single vaa order (103): the transfer is redeemed to MAIN here
+  and its token bridge claim is the only claimed flag, no pair, ledger
+  or final. accounts: payer, msg, state, MAIN, mint from, mint to, token
+  bridge config, claim, endpoint, MAIN's `from` wallet, wrapped meta or
+  custody, mint authority or custody signer, mint registry, then rent,
+  system program, wormhole, token program, token bridge. data: state
+  nonce, MAIN nonce, mint to nonce, wrapped.
+ */
+static noinline u64 mayan_claim_single(struct prog_ctx *ctx)
+{
+	SolAccountInfo accounts[CLAIM_SINGLE_KA_NUM];
+	struct claim_acc mayan;
+	struct wh_redeem_acc redeem;
+	SolAccountInfo *mints;
+	u64 result;
+
+	mayan_debug("mayan claim single");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+
+	result = parse_claim_single_accounts(ctx, &mayan);
 	if (result != SUCCESS)
 		return result;
 
-	result = parse_rent_account(ctx, &ctx->rent);
+	parse_wh_redeem_accounts(ctx, &redeem);
+	mints = ctx_next_account(ctx);
+	redeem.wrapped = read_u8(ctx) != 0;
+
+	result = check_cursors(ctx);
 	if (result != SUCCESS)
 		return result;
 
-	// check cursor
-	result = check_cursors(ctx);
+	result = wh_check_posted_vaa(ctx, mayan.msg1);
+	if (result != SUCCESS)
+		return result;
+
+	result = validate_vaa_single(&mayan.vaa, mayan.main->key);
 	if (result != SUCCESS)
 		return result;
 
+	if (!validate_mint_to(ctx, &mayan, mints)) {
+		mayan_error("mints are bad");
+		return ERROR_CUSTOM_ZERO;
+	}
 
-	mayan_debug("get before!");
-	result = spl_get_amount(swap.s_acc.to, &before);
+	redeem.msg = mayan.msg1;
+	redeem.mint = mayan.mint_from;
+	redeem.owner = mayan.main->key;
+	redeem.payer = mayan.owner->key;
+
+	result = wh_redeem(ctx, &redeem);
 	if (result != SUCCESS)
 		return result;
+
+	result = ctx_load_rent(ctx);
+	if (result != SUCCESS)
+		return result;
+
+	if (!mayan_init_state(ctx, &mayan)) {
+		mayan_error("cannot initialize state");
+		return ERROR_CUSTOM_ZERO;
+	}
+
+	mayan_emit_claimed(mayan.state->data);
+
+	return SUCCESS;
+}
+
+/*
+  claim up to CLAIM_BATCH_MAX pairs at once into free slots. every pair
+  has the same accounts and data as 102, slot included; no account is
+  created. one bad pair fails the whole batch, a slot named twice is no
+  longer free the second time.
+ */
+static noinline u64 mayan_claim_batch(struct prog_ctx *ctx)
+{
+	SolAccountInfo accounts[CLAIM_BATCH_KA_NUM];
+	struct claim_acc mayan;
+	struct claim_proof proof;
+	SolAccountInfo *slot;
+	u64 result;
+	u8 count;
+	u8 i;
+
+	mayan_debug("mayan claim batch");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+
+	count = read_u8(ctx);
+	if (count == 0 || count > CLAIM_BATCH_MAX) {
+		mayan_error("bad batch size");
+		mayan_debug_64(count, CLAIM_BATCH_MAX, 0, 0, 0);
+		return ERROR_INVALID_ARGUMENT;
+	}
+
+	for (i = 0; i < count; i++) {
+		mayan_debug_64(i, count, 0, 0, 0);
+
+		result = parse_claim_accounts(ctx, &mayan);
+		if (result != SUCCESS)
+			return result;
+
+		parse_claim_proof(ctx, &proof);
+		slot = ctx_next_account(ctx);
+
+		// check cursor
+		result = check_cursors(ctx);
+		if (result != SUCCESS)
+			return result;
+
+		result = check_claim(ctx, &mayan, &proof);
+		if (result != SUCCESS)
+			return result;
+
+		result = claim_to_slot(ctx, &mayan, slot);
+		if (result != SUCCESS)
+			return result;
+
+		mayan_emit_claimed(mayan.state->data);
+	}
+
+	return SUCCESS;
+}
+
+// swaps a claimed state, on success the state is STATE_SWAP_DONE
+static u64 swap_x(struct prog_ctx *ctx, struct swap_transitive_acc *swap,
+		  bool transitive)
+{
+	u64 result;
+
+	u64 before;
+	u64 after;
+	u64 diff;
 	
+	u64 amount = 0;
+	u64 amount_min = 0;
+	u64 fee = 0;
+	u64 rate = 0;
+	u8 decimal = 0;
+
 	mayan_debug("calcs!");
-	amount = mayan_data_amount(swap.state->data);
-	amount_min = mayan_data_amount_min(swap.state->data);
+	amount = mayan_data_amount(swap->state->data);
+	amount_min = mayan_data_amount_min(swap->state->data);
 
-	rate = mayan_data_rate(swap.state->data);
-	decimal = mayan_data_decimal(swap.state->data);
-	fee = mayan_data_fee_swap(swap.state->data);
+	rate = mayan_data_rate(swap->state->data);
+	decimal = mayan_data_decimal(swap->state->data);
+	fee = mayan_data_fee_swap(swap->state->data);
 
 	mayan_debug_64(amount, 0, rate, decimal, fee);
 
@@ -205,18 +442,47 @@ static u64 mayan_swap_x(struct prog_ctx *ctx, bool transitive)
 	}
 
 	amount -= fee;
-	mayan_debug_64(amount, 0, before, 0, 0);
+	mayan_debug_64(amount, 0, 0, 0, 0);
 
 	mayan_debug("swap!");
 
-	if (transitive) {
-		result = dex_swap_transitive(ctx, &swap.m1, &swap.m2,
-		                             &swap.s_acc, amount,
-		                             rate, decimal);
+	// direct fills are read on the open orders, `to` may not have them yet
+	if (swap->direct && transitive) {
+		result = dex_direct_transitive(ctx, &swap->m1, &swap->m2,
+					       &swap->s_acc, amount,
+					       swap->settle, &diff);
+	} else if (swap->direct) {
+		result = dex_direct_simple(ctx, &swap->m1, &swap->s_acc,
+					   swap->side, amount, swap->settle,
+					   &diff);
 	} else {
-		result = dex_swap_simple(ctx, &swap.m1, &swap.s_acc,
-		                         swap.side, amount, rate,
-		                         decimal);
+		mayan_debug("get before!");
+		result = spl_get_amount(swap->s_acc.to, &before);
+		if (result != SUCCESS)
+			return result;
+
+		if (transitive) {
+			result = dex_swap_transitive(ctx, &swap->m1, &swap->m2,
+						     &swap->s_acc, amount,
+						     rate, decimal);
+		} else {
+			result = dex_swap_simple(ctx, &swap->m1, &swap->s_acc,
+						 swap->side, amount, rate,
+						 decimal);
+		}
+
+		if (result != SUCCESS) {
+			mayan_debug("swap returned error!");
+			return result;
+		}
+
+		mayan_debug("get after!");
+		result = spl_get_amount(swap->s_acc.to, &after);
+		if (result != SUCCESS)
+			return result;
+		diff = after - before;
+
+		mayan_debug_64(before, after, 0, 0, diff);
 	}
 
 	if (result != SUCCESS) {
@@ -224,14 +490,8 @@ static u64 mayan_swap_x(struct prog_ctx *ctx, bool transitive)
 		return result;
 	}
 
-	mayan_debug("get after!");
-	result = spl_get_amount(swap.s_acc.to, &after);
-	if (result != SUCCESS)
-		return result;
-	diff = after - before;
-
 	mayan_debug("swap amount:");
-	mayan_debug_64(before, after, 0, 0, diff);
+	mayan_debug_64(amount, 0, 0, 0, diff);
 
 	if (diff == 0) {
 		mayan_error("in pool chera 0 e?");
@@ -246,13 +506,58 @@ static u64 mayan_swap_x(struct prog_ctx *ctx, bool transitive)
 	}
 
 	mayan_debug("setting state");
-	mayan_data_set_state(swap.state->data, STATE_SWAP_DONE);
-	mayan_data_set_amount(swap.state->data, diff);
+	mayan_data_set_state(swap->state->data, STATE_SWAP_DONE);
+	mayan_data_set_amount(swap->state->data, diff);
+
+	mayan_emit_swapped(swap->state->data, amount, diff);
+
+	return SUCCESS;
+}
+
+// accounts are bound by the caller, sized for its variant
+static u64 mayan_swap_x(struct prog_ctx *ctx, bool transitive, bool direct)
+{
+	struct swap_transitive_acc swap = {.direct = direct};
+
+	u64 result;
+
+	result = parse_swap_x_accounts(ctx, &swap, transitive);
+	if (result != SUCCESS)
+		return result;
+
+	// check cursor
+	result = check_cursors(ctx);
+	if (result != SUCCESS)
+		return result;
+
+	result = swap_x(ctx, &swap, transitive);
+	if (result != SUCCESS)
+		return result;
 
 	mayan_debug("Everythin's fine! done!");
 	return SUCCESS;
 }
 
+static noinline u64 mayan_swap_simple(struct prog_ctx *ctx, bool direct)
+{
+	SolAccountInfo accounts[SWAP_SIMPLE_KA_NUM];
+
+	mayan_debug("mayan swap simple");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+
+	return mayan_swap_x(ctx, false, direct);
+}
+
+static noinline u64 mayan_swap_transitive(struct prog_ctx *ctx, bool direct)
+{
+	SolAccountInfo accounts[SWAP_TRANSITIVE_KA_NUM];
+
+	mayan_debug("mayan swap transitive");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+
+	return mayan_swap_x(ctx, true, direct);
+}
+
 static bool can_cancel(struct prog_ctx *ctx, struct transfer_acc *trx)
 {
 	u64 now;
@@ -279,54 +584,62 @@ static bool can_cancel(struct prog_ctx *ctx, struct transfer_acc *trx)
 	return false;
 }
 
-static u64 mayan_trx(struct prog_ctx *ctx, bool is_wrapped)
+/*
+  the vault is ours, so the fee is moved without a CPI. the amount is the
+  one of the bridge config, not the instruction's. a wrong config or fee
+  collector fails the wormhole CPI and takes the lamports back with it.
+ */
+static u64 pay_fee_from_vault(struct prog_ctx *ctx, struct transfer_acc *trx)
 {
-	struct transfer_acc trx = {0};
-
-	u64 amount;
+	u64 fee;
 	u64 result;
-	u64 seq_id;
 
-	mayan_debug("mayan transfer native");
-	result = parse_transfer_accounts(ctx, &trx, is_wrapped);
+	result = wh_message_fee(ctx, trx->transfer.bridge_conf, &fee);
 	if (result != SUCCESS)
 		return result;
 
-	result = parse_rent_account(ctx, &ctx->rent);
-	if (result != SUCCESS)
-		return result;
+	if (*trx->fee_vault->lamports < rent_minimum_balance(&ctx->rent, 0) + fee) {
+		mayan_error("fee vault is empty");
+		return ERROR_INSUFFICIENT_FUNDS;
+	}
 
-	result = parse_clock_account(ctx, &ctx->clock);
-	if (result != SUCCESS)
-		return result;
+	*trx->fee_vault->lamports -= fee;
+	*trx->transfer.fee_acc->lamports += fee;
+	trx->transfer.fee = fee;
 
-	// check cursor
-	result = check_cursors(ctx);
-	if (result != SUCCESS)
-		return result;
+	return SUCCESS;
+}
 
-	// can cancel?
-	if (trx.try_cancel && !can_cancel(ctx, &trx)) {
-		mayan_error("you cannot cancel. sorry!");
-		return ERROR_CUSTOM_ZERO;
-	}
+// sends the state amount back through wormhole and finishes the state
+static u64 trx(struct prog_ctx *ctx, struct transfer_acc *trx,
+	       bool is_wrapped)
+{
+	u64 amount;
+	u64 result;
+	u64 seq_id;
 
 	// set amount
-	amount = trx.transfer.amount;
+	amount = trx->transfer.amount;
 	mayan_debug("amounts");
-	mayan_debug_64(amount, 0, 0, trx.transfer.fee, trx.transfer.relayer_fee);
+	mayan_debug_64(amount, 0, 0, trx->transfer.fee,
+		       trx->transfer.relayer_fee);
 
 	mayan_debug("transfer wormhole first fee");
-	result = system_transfer(ctx, trx.owner->key, trx.transfer.fee_acc->key,
-				 trx.transfer.fee);
+	if (trx->fee_vault != NULL) {
+		result = pay_fee_from_vault(ctx, trx);
+	} else {
+		result = system_transfer(ctx, trx->owner->key,
+					 trx->transfer.fee_acc->key,
+					 trx->transfer.fee);
+	}
 	if (result != SUCCESS) {
 		mayan_debug("cannot transfer fee");
 		return result;
 	}
 
 	mayan_debug("spl approve");
-	result = spl_approve(ctx, trx.main->key, trx.transfer.acc->key,
-			     trx.transfer.auth_signer->key, amount);
+	result = spl_approve(ctx, trx->main->key, trx->transfer.acc->key,
+			     trx->transfer.auth_signer->key, amount);
 
 	if (result != SUCCESS) {
 		mayan_debug("cannot approve transfer");
@@ -335,9 +648,9 @@ static u64 mayan_trx(struct prog_ctx *ctx, bool is_wrapped)
 
 	mayan_debug("transfer!");
 	if (is_wrapped) {
-		result = wh_transfer_wrapped(ctx, &trx.transfer);
+		result = wh_transfer_wrapped(ctx, &trx->transfer);
 	} else {
-		result = wh_transfer_native(ctx, &trx.transfer);
+		result = wh_transfer_native(ctx, &trx->transfer);
 	}
 	
 	if (result != SUCCESS) {
@@ -345,7 +658,7 @@ static u64 mayan_trx(struct prog_ctx *ctx, bool is_wrapped)
 		return result;
 	}
 
-	result = wh_seq_id(trx.transfer.seq_key, &seq_id);
+	result = wh_seq_id(trx->transfer.seq_key, &seq_id);
 
 	if (result != SUCCESS) {
 		mayan_debug("cannot get seq id");
@@ -353,31 +666,635 @@ static u64 mayan_trx(struct prog_ctx *ctx, bool is_wrapped)
 	}
 
 	mayan_debug("setting state");
-	mayan_data_set_state(trx.state->data, trx.success_state);
-	mayan_data_set_seq(trx.state->data, seq_id);
+	mayan_data_set_state(trx->state->data, trx->success_state);
+	mayan_data_set_seq(trx->state->data, seq_id);
+
+	mayan_emit_transferred(trx->state->data, trx->try_cancel, seq_id);
+
+	return SUCCESS;
+}
+
+static noinline u64 mayan_trx(struct prog_ctx *ctx, bool is_wrapped, bool fee_vault)
+{
+	SolAccountInfo accounts[TRANSFER_KA_NUM];
+	struct transfer_acc trn = {0};
+
+	u64 result;
+
+	mayan_debug("mayan transfer native");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+
+	result = parse_transfer_accounts(ctx, &trn, is_wrapped, fee_vault);
+	if (result != SUCCESS)
+		return result;
+
+	// check cursor
+	result = check_cursors(ctx);
+	if (result != SUCCESS)
+		return result;
+
+	// only a cancel looks at the time
+	if (trn.try_cancel) {
+		result = ctx_load_clock(ctx);
+		if (result != SUCCESS)
+			return result;
+	}
+
+	// the vault has to stay rent exempt
+	if (fee_vault) {
+		result = ctx_load_rent(ctx);
+		if (result != SUCCESS)
+			return result;
+	}
+
+	// can cancel?
+	if (trn.try_cancel && !can_cancel(ctx, &trn)) {
+		mayan_error("you cannot cancel. sorry!");
+		return ERROR_CUSTOM_ZERO;
+	}
+
+	result = trx(ctx, &trn, is_wrapped);
+	if (result != SUCCESS)
+		return result;
 
 	mayan_debug("Everythin's fine!");
 	return SUCCESS;
 }
 
+/*
+  claim, swap and transfer back in one instruction.
+
+  no account is created: the order lives on the stack while it runs and
+  the final account is only passed (claim layout) and checked empty. the
+  ledger bit set by check_claim is the replay guard, every claim path
+  refuses the VAA pair afterwards. if any step fails the whole
+  transaction fails and the relayer falls back to claim/swap/transfer.
+ */
+#define ATOMIC_TRANSITIVE (1 << 0)
+#define ATOMIC_DIRECT (1 << 1)
+static u64 atomic_x(struct prog_ctx *ctx, bool transitive, bool direct)
+{
+	u64 order[MAYAN_STATE_SIZE / 8] = {0};
+	SolAccountInfo state;
+
+	struct claim_acc mayan;
+	struct claim_proof proof;
+	struct swap_transitive_acc swap = {.direct = direct};
+	struct transfer_acc trn = {0};
+
+	bool is_wrapped;
+	u64 result;
+
+	swap.settle = true; // the transfer needs the fill in `to`
+	is_wrapped = read_u8(ctx) != 0;
+
+	// claim
+	result = parse_claim_accounts(ctx, &mayan);
+	if (result != SUCCESS)
+		return result;
+
+	parse_claim_proof(ctx, &proof);
+
+	result = ctx_load_clock(ctx);
+	if (result != SUCCESS)
+		return result;
+
+	// swap
+	swap.main = mayan.main;
+	swap.s_acc.main = mayan.main->key;
+
+	result = parse_market_accounts(ctx, &swap.m1);
+	if (result != SUCCESS)
+		return result;
+
+	if (transitive) {
+		result = parse_market_accounts(ctx, &swap.m2);
+		if (result != SUCCESS)
+			return result;
+	}
+
+	swap.s_acc.from = ctx_next_account(ctx);
+	swap.s_acc.to = ctx_next_account(ctx);
+	if (transitive) {
+		swap.s_acc.tmp = ctx_next_account(ctx);
+	}
+
+	// transfer
+	trn.owner = mayan.owner;
+	trn.main = mayan.main;
+
+	if (is_wrapped) {
+		result = parse_wh_trw_accounts(ctx, &trn.transfer);
+	} else {
+		result = parse_wh_trn_accounts(ctx, &trn.transfer);
+	}
+
+	if (result != SUCCESS)
+		return result;
+
+	// check cursor
+	result = check_cursors(ctx);
+	if (result != SUCCESS)
+		return result;
+
+	result = check_claim(ctx, &mayan, &proof);
+	if (result != SUCCESS)
+		return result;
+
+	state = (SolAccountInfo){
+		.key = mayan.state->key,
+		.data = (u8 *)order,
+		.data_len = MAYAN_STATE_SIZE,
+	};
+	mayan.state = &state;
+	swap.state = &state;
+	trn.state = &state;
+
+	if (!mayan_write_state(&mayan)) {
+		mayan_error("cannot initialize state");
+		return ERROR_CUSTOM_ZERO;
+	}
+
+	if (ctx->clock.posix > mayan_data_deadline(state.data)) {
+		mayan_error("deadline expired, use claim");
+		return ERROR_CUSTOM_ZERO;
+	}
+
+	mayan_emit_claimed(state.data);
+
+	result = validate_swap_x(ctx, &swap, transitive);
+	if (result != SUCCESS)
+		return result;
+
+	result = swap_x(ctx, &swap, transitive);
+	if (result != SUCCESS)
+		return result;
+
+	result = validate_transfer(&trn, STATE_SWAP_DONE);
+	if (result != SUCCESS)
+		return result;
+
+	result = trx(ctx, &trn, is_wrapped);
+	if (result != SUCCESS)
+		return result;
+
+	mayan_debug("Everythin's fine!");
+	return SUCCESS;
+}
+
+static noinline u64 mayan_atomic_simple(struct prog_ctx *ctx, bool direct)
+{
+	SolAccountInfo accounts[ATOMIC_SIMPLE_KA_NUM];
+
+	mayan_debug("mayan atomic simple");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+
+	return atomic_x(ctx, false, direct);
+}
+
+static noinline u64 mayan_atomic_transitive(struct prog_ctx *ctx, bool direct)
+{
+	SolAccountInfo accounts[ATOMIC_TRANSITIVE_KA_NUM];
+
+	mayan_debug("mayan atomic transitive");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+
+	return atomic_x(ctx, true, direct);
+}
+
+// swap flags: transitive, direct dex orders
+static u64 mayan_atomic(struct prog_ctx *ctx)
+{
+	u8 flags = read_u8(ctx);
+	bool direct = (flags & ATOMIC_DIRECT) != 0;
+
+	if (flags & ATOMIC_TRANSITIVE)
+		return mayan_atomic_transitive(ctx, direct);
+
+	return mayan_atomic_simple(ctx, direct);
+}
+
+/*
+  creates one of the program accounts of mayan.h that are not orders.
+  accounts: payer, the account, system program. the seeds come from the
+  instruction data.
+ */
+static u64 create_pda(struct prog_ctx *ctx, const SolAccountInfo *payer,
+		      const SolAccountInfo *acc, const SolSignerSeed *seeds,
+		      u64 seeds_len, const SolPubkey *owner, u64 space)
+{
+	u64 result;
+
+	result = check_cursors(ctx);
+	if (result != SUCCESS)
+		return result;
+
+	if (!payer->is_signer) {
+		mayan_error("payer is not signer");
+		return ERROR_MISSING_REQUIRED_SIGNATURES;
+	}
+	ctx->payer = payer->key;
+
+	set_ctx_pda_seed(ctx, seeds, seeds_len);
+	if (!validate_seed_addr(ctx, 0, acc->key)) {
+		mayan_error("account addr is wrong");
+		return ERROR_INVALID_ARGUMENT;
+	}
+
+	result = ctx_load_rent(ctx);
+	if (result != SUCCESS)
+		return result;
+
+	return system_create_account(ctx, acc->key, payer->key, owner,
+				     rent_minimum_balance(&ctx->rent, space),
+				     space);
+}
+
+// data: nonce. the vault starts rent exempt and empty
+static noinline u64 mayan_init_fee_vault(struct prog_ctx *ctx)
+{
+	SolAccountInfo accounts[INIT_PDA_KA_NUM];
+	SolAccountInfo *payer;
+	SolAccountInfo *vault;
+
+	mayan_debug("mayan init fee vault");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+	payer = ctx_next_account(ctx);
+	vault = ctx_next_account(ctx);
+
+	const SolSignerSeed seeds[] = {
+		{.addr=fee_vault_seed, .len=SOL_ARRAY_SIZE(fee_vault_seed)},
+		{.addr=read_buffer(ctx, 1), .len=1},
+	};
+
+	return create_pda(ctx, payer, vault, seeds, SOL_ARRAY_SIZE(seeds),
+			  ctx->prog_id, 0);
+}
 
-static u64 mayan_test(struct prog_ctx *ctx)
+/*
+  data: chain u16, page u64. the page takes the canonical bump, so there
+  is one page per chain and page; it is kept in the header for claims.
+ */
+static noinline u64 mayan_init_ledger(struct prog_ctx *ctx)
 {
+	SolAccountInfo accounts[INIT_PDA_KA_NUM];
+	SolAccountInfo *payer;
+	SolAccountInfo *ledger;
+	SolPubkey addr;
+	const u8 *chain;
+	const u8 *page;
+	u64 result;
+	u8 bump;
+
+	mayan_debug("mayan init ledger");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+	payer = ctx_next_account(ctx);
+	ledger = ctx_next_account(ctx);
+
+	chain = read_buffer(ctx, 2);
+	page = read_buffer(ctx, 8);
+
+	const SolSignerSeed seeds[] = {
+		{.addr=ledger_seed, .len=SOL_ARRAY_SIZE(ledger_seed)},
+		{.addr=chain, .len=2},
+		{.addr=page, .len=8},
+		{.addr=&bump, .len=1},
+	};
+
+	result = sol_try_find_program_address(seeds, SOL_ARRAY_SIZE(seeds) - 1,
+					      ctx->prog_id, &addr, &bump);
+	if (result != SUCCESS || !pubkey_same(&addr, ledger->key)) {
+		mayan_error("ledger page is not canonical");
+		return ERROR_INVALID_ARGUMENT;
+	}
+
+	result = create_pda(ctx, payer, ledger, seeds, SOL_ARRAY_SIZE(seeds),
+			    ctx->prog_id, MAYAN_LEDGER_SIZE);
+	if (result != SUCCESS)
+		return result;
+
+	mayan_ledger_set_chain(ledger->data, *(const u16 *)chain);
+	mayan_ledger_set_bump(ledger->data, bump);
+	mayan_ledger_set_page(ledger->data, *(const u64 *)page);
+
+	return SUCCESS;
+}
+
+/*
+  data: index u32, nonce, relayer (zero for none). a fresh slot is a free
+  v2 state, its payer and the relayer can reclaim it (150).
+ */
+static noinline u64 mayan_init_slot(struct prog_ctx *ctx)
+{
+	SolAccountInfo accounts[INIT_PDA_KA_NUM];
+	SolAccountInfo *payer;
+	SolAccountInfo *slot;
+	const u8 *index;
+	const u8 *relayer;
+	u64 result;
+
+	mayan_debug("mayan init slot");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+	payer = ctx_next_account(ctx);
+	slot = ctx_next_account(ctx);
+
+	index = read_buffer(ctx, 4);
+
+	const SolSignerSeed seeds[] = {
+		{.addr=slot_seed, .len=SOL_ARRAY_SIZE(slot_seed)},
+		{.addr=index, .len=4},
+		{.addr=read_buffer(ctx, 1), .len=1},
+	};
+	relayer = read_buffer(ctx, 32);
+
+	result = create_pda(ctx, payer, slot, seeds, SOL_ARRAY_SIZE(seeds),
+			    ctx->prog_id, MAYAN_STATE_SIZE);
+	if (result != SUCCESS)
+		return result;
+
+	mayan_data_set_version(slot->data, MAYAN_STATE_VERSION);
+	mayan_data_set_state(slot->data, STATE_NOT_INITIALIZED);
+	mayan_data_set_payer(slot->data, payer->key->x);
+	mayan_data_set_relayer(slot->data, relayer);
+
+	return SUCCESS;
+}
+
+/*
+  the open orders of the pool. accounts: payer, open orders, market,
+  MAIN, system program, dex, rent. data: nonce, main nonce. the account
+  is created for the dex and initialized with MAIN as its owner.
+ */
+static noinline u64 mayan_init_open_orders(struct prog_ctx *ctx)
+{
+	SolAccountInfo accounts[INIT_OPEN_ORDERS_KA_NUM];
+	SolAccountInfo *payer;
+	SolAccountInfo *oo;
+	SolAccountInfo *market;
+	SolAccountInfo *main;
+	const u8 *nonce;
+	u64 result;
+
+	mayan_debug("mayan init open orders");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+	payer = ctx_next_account(ctx);
+	oo = ctx_next_account(ctx);
+	market = ctx_next_account(ctx);
+	main = ctx_next_account(ctx);
+
+	nonce = read_buffer(ctx, 1);
+	set_ctx_main_seed(ctx, read_buffer(ctx, 1));
+
+	const SolSignerSeed seeds[] = {
+		{.addr=open_orders_seed, .len=SOL_ARRAY_SIZE(open_orders_seed)},
+		{.addr=(const u8 *)market->key, .len=32},
+		{.addr=nonce, .len=1},
+	};
+
+	result = create_pda(ctx, payer, oo, seeds, SOL_ARRAY_SIZE(seeds),
+			    &ctx->progs.dex, SERUM_OPEN_ORDERS_SIZE);
+	if (result != SUCCESS)
+		return result;
+
+	return dex_init_open_orders(ctx, market->key, oo->key, main->key);
+}
+
+/*
+  settles the fills left in an open orders of the pool to the MAIN
+  wallets of its market. accounts: the market accounts, MAIN, coin
+  wallet, pc wallet, dex, token program. data: main nonce. anyone can
+  sweep, the wallets have to be MAIN's.
+ */
+static noinline u64 mayan_sweep(struct prog_ctx *ctx)
+{
+	SolAccountInfo accounts[SWEEP_KA_NUM];
+	struct serum_market m;
+	SolAccountInfo *main;
+	SolAccountInfo *coin;
+	SolAccountInfo *pc;
+	u64 result;
+
+	mayan_debug("mayan sweep");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+
+	result = parse_market_accounts(ctx, &m);
+	if (result != SUCCESS)
+		return result;
+
+	main = ctx_next_account(ctx);
+	coin = ctx_next_account(ctx);
+	pc = ctx_next_account(ctx);
+
+	set_ctx_main_seed(ctx, read_buffer(ctx, 1));
+
+	result = check_cursors(ctx);
+	if (result != SUCCESS)
+		return result;
+
+	// MAIN signs below, a wrong main has no signature
+	if (!spl_owner_is(ctx, coin, main->key) ||
+	    !spl_owner_is(ctx, pc, main->key)) {
+		mayan_error("wallets are not main's");
+		return ERROR_INVALID_ARGUMENT;
+	}
+
+	return dex_settle(ctx, &m, main->key, coin->key, pc->key);
+}
+
+// data: nonce. the registry starts empty, the payer is its authority
+static noinline u64 mayan_init_mints(struct prog_ctx *ctx)
+{
+	SolAccountInfo accounts[INIT_PDA_KA_NUM];
+	SolAccountInfo *payer;
+	SolAccountInfo *registry;
+	u64 result;
+
+	mayan_debug("mayan init mints");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+	payer = ctx_next_account(ctx);
+	registry = ctx_next_account(ctx);
+
+	const SolSignerSeed seeds[] = {
+		{.addr=mints_seed, .len=SOL_ARRAY_SIZE(mints_seed)},
+		{.addr=read_buffer(ctx, 1), .len=1},
+	};
+
+	result = create_pda(ctx, payer, registry, seeds, SOL_ARRAY_SIZE(seeds),
+			    ctx->prog_id, MAYAN_MINTS_SIZE);
+	if (result != SUCCESS)
+		return result;
+
+	mayan_mints_set_authority(registry->data, payer->key->x);
+	return SUCCESS;
+}
+
+/*
+  adds a token to the mint registry. accounts: registry, mint, registry
+  authority (signer). data: chain u16, token address. the mint is
+  derived once here, with the canonical bump.
+ */
+static noinline u64 mayan_register_mint(struct prog_ctx *ctx)
+{
+	SolAccountInfo accounts[REGISTER_MINT_KA_NUM];
+	SolAccountInfo *registry;
+	SolAccountInfo *mint;
+	SolAccountInfo *authority;
+	const u8 *chain;
+	const u8 *tkn_addr;
+	u64 result;
+
+	mayan_debug("mayan register mint");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+	registry = ctx_next_account(ctx);
+	mint = ctx_next_account(ctx);
+	authority = ctx_next_account(ctx);
+
+	chain = read_buffer(ctx, 2);
+	tkn_addr = read_buffer(ctx, 32);
+
+	result = check_cursors(ctx);
+	if (result != SUCCESS)
+		return result;
+
+	return mints_add(ctx, registry, mint, authority, *(const u16 *)chain,
+			 tkn_addr);
+}
+
+/*
+  upgrades up to MIGRATE_BATCH_MAX v1 states to v2 in place. accounts:
+  funder (signer), MAIN, then the states, system program. data: count,
+  then the state and MAIN nonces of every state (used by states older
+  than v1.2). the funder tops up the rent of the bigger state and is not
+  recorded as its payer. anyone can migrate, the order stays the same.
+ */
+static noinline u64 mayan_migrate(struct prog_ctx *ctx)
+{
+	SolAccountInfo accounts[MIGRATE_KA_NUM];
+	SolAccountInfo *funder;
+	SolAccountInfo *main;
+	SolAccountInfo *state;
+	const u8 *nonces;
+	u64 rent;
+	u64 result;
+	u8 count;
+
+	mayan_debug("mayan migrate");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+
+	funder = ctx_next_account(ctx);
+	main = ctx_next_account(ctx);
+	count = read_u8(ctx);
+	if (count == 0 || count > MIGRATE_BATCH_MAX) {
+		mayan_error("bad batch size");
+		return ERROR_INVALID_ARGUMENT;
+	}
+
+	result = ctx_load_rent(ctx);
+	if (result != SUCCESS)
+		return result;
+
+	rent = rent_minimum_balance(&ctx->rent, MAYAN_STATE_SIZE);
+
+	for (u8 i = 0; i < count; i++) {
+		state = ctx_next_account(ctx);
+		nonces = read_buffer(ctx, 2);
+
+		result = check_cursors(ctx);
+		if (result != SUCCESS)
+			return result;
+
+		if (*state->lamports < rent) {
+			result = system_transfer(ctx, funder->key, state->key,
+						 rent - *state->lamports);
+			if (result != SUCCESS)
+				return result;
+		}
+
+		result = state_migrate(ctx, state, main, nonces[0], nonces[1]);
+		if (result != SUCCESS)
+			return result;
+	}
+
+	return SUCCESS;
+}
+
+/*
+  closes up to RECLAIM_BATCH_MAX done orders, each to the payer that
+  funded its state. accounts: signer, then per order the state, msg1,
+  its claim ledger page and the payer. data: count. the signer is the
+  payer of every order or the relayer it names. lamports are moved
+  without a CPI and the data is zeroed. the ledger bit of every order is
+  set, so orders claimed before the ledger stay claimed once their
+  accounts are gone.
+ */
+static noinline u64 mayan_reclaim(struct prog_ctx *ctx)
+{
+	SolAccountInfo accounts[RECLAIM_KA_NUM];
+	SolAccountInfo *signer;
+	SolAccountInfo *state;
+	SolAccountInfo *msg1;
+	SolAccountInfo *ledger;
+	SolAccountInfo *payer;
+	u64 result;
+	u8 count;
+
+	mayan_debug("mayan reclaim");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+
+	signer = ctx_next_account(ctx);
+	count = read_u8(ctx);
+	if (count == 0 || count > RECLAIM_BATCH_MAX) {
+		mayan_error("bad batch size");
+		return ERROR_INVALID_ARGUMENT;
+	}
+
+	for (u8 i = 0; i < count; i++) {
+		state = ctx_next_account(ctx);
+		msg1 = ctx_next_account(ctx);
+		ledger = ctx_next_account(ctx);
+		payer = ctx_next_account(ctx);
+
+		result = check_cursors(ctx);
+		if (result != SUCCESS)
+			return result;
+
+		result = check_reclaim(ctx, state, msg1, signer, payer);
+		if (result != SUCCESS)
+			return result;
+
+		result = ledger_mark_claimed(ctx, ledger,
+					     vaa_chain_id(msg1->data),
+					     vaa_seq_id(msg1->data), false);
+		if (result != SUCCESS)
+			return result;
+
+		*payer->lamports += *state->lamports;
+		*state->lamports = 0;
+		sol_memset(state->data, 0, state->data_len);
+	}
+
+	return SUCCESS;
+}
+
+static noinline u64 mayan_test(struct prog_ctx *ctx)
+{
+	SolAccountInfo accounts[CLOSE_KA_NUM];
 	struct close_acc close;
 	SolAccountInfo *owner;
 
 	u64 result;
 
-	u8 state;
 	u64 lamports;
 	
 	mayan_debug("mayan test");
+	ctx_bind_accounts(ctx, accounts, SOL_ARRAY_SIZE(accounts));
+
 	result = parse_close_accounts(ctx, &close);
 	if (result != SUCCESS) {
 		mayan_error("cannot parse accounts");
 		return result;
 	}
-	owner = ctx->cursor++;
+	owner = ctx_next_account(ctx);
 
 	if (!owner->is_signer) {
 		mayan_error("owner is not signer");
@@ -388,8 +1305,7 @@ static u64 mayan_test(struct prog_ctx *ctx)
 	lamports = *close.state->lamports;
 	mayan_debug_64(close.state->data_len, lamports, 0, 0, 0);
 
-	state = mayan_data_state(close.state->data);
-	mayan_debug_64(state, 0, 0, 0, 0);
+	mayan_debug_64(mayan_data_state(close.state->data), 0, 0, 0, 0);
 
 	//result = system_transfer(ctx, close.state->key, owner->key, lamports);
 
@@ -404,16 +1320,16 @@ static u64 mayan_test(struct prog_ctx *ctx)
 	return SUCCESS;
 }
 
-#define MAXIMUM_KA_NUM 30
 extern u64 entrypoint(const uint8_t *input)
 {
+#ifdef DEBUG_FLAG
 	sol_log(BUILD_TEXT);
+#endif
 
-	SolAccountInfo accounts[MAXIMUM_KA_NUM];
-	SolParameters params = (SolParameters){.ka = accounts};
+	SolParameters params = {0};
 	struct prog_ctx ctx = {0};
 	
-	if (!sol_deserialize(input, &params, SOL_ARRAY_SIZE(accounts))) {
+	if (!ctx_parse_input(input, &params, &ctx.cursor)) {
 		return ERROR_INVALID_ARGUMENT;
 	}
 
@@ -429,15 +1345,49 @@ extern u64 entrypoint(const uint8_t *input)
 	case 50:
 		return mayan_test(&ctx);
 	case 100:
-		return mayan_claim(&ctx);
+		return mayan_claim(&ctx, false);
+	case 101:
+		return mayan_claim_batch(&ctx);
+	case 102:
+		return mayan_claim(&ctx, true);
+	case 103:
+		return mayan_claim_single(&ctx);
 	case 110:
-		return mayan_swap_x(&ctx, true);
+		return mayan_swap_transitive(&ctx, false);
 	case 111:
-		return mayan_swap_x(&ctx, false);
+		return mayan_swap_simple(&ctx, false);
+	case 112:
+		return mayan_swap_transitive(&ctx, true);
+	case 113:
+		return mayan_swap_simple(&ctx, true);
 	case 120:
-		return mayan_trx(&ctx, false);
+		return mayan_trx(&ctx, false, false);
 	case 121:
-		return mayan_trx(&ctx, true);
+		return mayan_trx(&ctx, true, false);
+	case 122:
+		return mayan_trx(&ctx, false, true);
+	case 123:
+		return mayan_trx(&ctx, true, true);
+	case 130:
+		return mayan_atomic(&ctx);
+	case 140:
+		return mayan_init_fee_vault(&ctx);
+	case 141:
+		return mayan_init_ledger(&ctx);
+	case 142:
+		return mayan_init_slot(&ctx);
+	case 143:
+		return mayan_init_open_orders(&ctx);
+	case 144:
+		return mayan_sweep(&ctx);
+	case 145:
+		return mayan_init_mints(&ctx);
+	case 146:
+		return mayan_register_mint(&ctx);
+	case 147:
+		return mayan_migrate(&ctx);
+	case 150:
+		return mayan_reclaim(&ctx);
 	default:
 		return ERROR_INVALID_INSTRUCTION_DATA;
 	}
@@ -1,30 +1,38 @@
 #include "spl.h"
+#include "cpi.h"
+#include "layout.h"
 #include "sol/pubkey.h"
 #include "sol/types.h"
 #include "utils.h"
 
 #define TOKEN_INSTRUCTION_APPROVE 4
+#define SYSTEM_INSTRUCTION_TRANSFER 2
+
+// approve: source, delegate, owner
+static const SolAccountMeta spl_approve_metas[] = {
+	CPI_W, CPI_R, CPI_S,
+};
+
+static const u8 spl_approve_data[SPL_APPROVE_IX_SIZE] = {
+	TOKEN_INSTRUCTION_APPROVE,
+};
+
 u64 spl_approve(struct prog_ctx *ctx, SolPubkey *owner, SolPubkey *acc,
 		SolPubkey *delegate, u64 amount)
 {
 	SolInstruction ix;
-	u8 data[9];
-	u8* data_ptr;
+	SolAccountMeta accounts[SOL_ARRAY_SIZE(spl_approve_metas)];
+	u8 data[SPL_APPROVE_IX_SIZE];
 
 	mayan_debug("spl approve > accs");
-
-	SolAccountMeta accounts[] = {
-	    {acc, true, false},
-	    {delegate, false, false},
-	    {owner, false, true},
-	};
-
+	cpi_from_template(accounts, spl_approve_metas);
+	accounts[0].pubkey = acc;
+	accounts[1].pubkey = delegate;
+	accounts[2].pubkey = owner;
 
 	mayan_debug("spl approve > data");
-	data_ptr = data;
-	write_u8(data, &data_ptr, TOKEN_INSTRUCTION_APPROVE);
-	write_u64(data, &data_ptr, amount);
-	check_buffer_done(data, data_ptr);
+	cpi_from_template(data, spl_approve_data);
+	spl_approve_ix_set_amount(data, amount);
 
 	mayan_debug("spl approve > ix");
 	ix.program_id = &(ctx->progs.spl);
@@ -33,30 +41,33 @@ u64 spl_approve(struct prog_ctx *ctx, SolPubkey *owner, SolPubkey *acc,
 	ix.data = data;
 	ix.data_len = SOL_ARRAY_SIZE(data);
 
-	return mayan_invoke(ctx, &ix);
+	return mayan_invoke(ctx, &ix, SIGN_MAIN);
 }
 
-#define SYSTEM_INSTRUCTION_TRANSFER 2
+// transfer: from, to. the tag is a u32
+static const SolAccountMeta system_transfer_metas[] = {
+	CPI_WS, CPI_W,
+};
+
+static const u8 system_transfer_data[SYSTEM_TRANSFER_IX_SIZE] = {
+	SYSTEM_INSTRUCTION_TRANSFER,
+};
+
 u64 system_transfer(struct prog_ctx *ctx, SolPubkey *from, SolPubkey *to,
 		    u64 amount)
 {
 	SolInstruction ix;
-	u8 data[12];
-	u8* data_ptr;
+	SolAccountMeta accounts[SOL_ARRAY_SIZE(system_transfer_metas)];
+	u8 data[SYSTEM_TRANSFER_IX_SIZE];
 
 	mayan_debug("system transfer > accs");
-
-	SolAccountMeta accounts[] = {
-		{from, true, true},
-		{to, true, false},
-	};
-
+	cpi_from_template(accounts, system_transfer_metas);
+	accounts[0].pubkey = from;
+	accounts[1].pubkey = to;
 
 	mayan_debug("system transfer > data");
-	data_ptr = data;
-	write_u32(data, &data_ptr, SYSTEM_INSTRUCTION_TRANSFER); // TODO check
-	write_i64(data, &data_ptr, amount);
-	check_buffer_done(data, data_ptr);
+	cpi_from_template(data, system_transfer_data);
+	system_transfer_ix_set_lamports(data, amount);
 
 	mayan_debug("system transfer > ix");
 	ix.program_id = &(ctx->progs.system);
@@ -65,7 +76,7 @@ u64 system_transfer(struct prog_ctx *ctx, SolPubkey *from, SolPubkey *to,
 	ix.data = data;
 	ix.data_len = SOL_ARRAY_SIZE(data);
 
-	return mayan_invoke(ctx, &ix);
+	return mayan_invoke(ctx, &ix, SIGN_NONE);
 }
 
 #define SYSTEM_INSTRUCTION_CREATE 0
@@ -74,33 +85,29 @@ u64 system_create_account(struct prog_ctx *ctx, SolPubkey *account,
 			  u64 lamports, u64 space)
 {
 	SolInstruction ix;
-	u8 data[52];
-	u8* data_ptr;
+	u8 data[SYSTEM_CREATE_IX_SIZE];
 
-	mayan_debug("system transfer > accs");
+	mayan_debug("system create > accs");
 
 	SolAccountMeta accounts[] = {
 		{payer, true, true},
 		{account, true, true},
 	};
 
+	mayan_debug("system create > data");
+	system_create_ix_set_tag(data, SYSTEM_INSTRUCTION_CREATE);
+	system_create_ix_set_lamports(data, lamports);
+	system_create_ix_set_space(data, space);
+	system_create_ix_set_owner(data, prog_id->x);
 
-	mayan_debug("system transfer > data");
-	data_ptr = data;
-	write_u32(data, &data_ptr, SYSTEM_INSTRUCTION_CREATE);
-	write_i64(data, &data_ptr, lamports);
-	write_i64(data, &data_ptr, space);
-	write_buffer(data, &data_ptr, (u8*)(prog_id), 32);
-	check_buffer_done(data, data_ptr);
-
-	mayan_debug("system transfer > ix");
+	mayan_debug("system create > ix");
 	ix.program_id = &(ctx->progs.system);
 	ix.accounts = accounts;
 	ix.account_len = SOL_ARRAY_SIZE(accounts);
 	ix.data = data;
 	ix.data_len = SOL_ARRAY_SIZE(data);
 
-	return mayan_invoke(ctx, &ix);
+	return mayan_invoke(ctx, &ix, SIGN_STATE);
 }
 
 u64 ctx_create_account(struct prog_ctx *ctx, SolPubkey *account, u64 space)
@@ -119,8 +126,6 @@ u64 ctx_create_account(struct prog_ctx *ctx, SolPubkey *account, u64 space)
 		return ERROR_CUSTOM_ZERO;
 	}
 
-	system_create_account(ctx, account, ctx->payer, ctx->prog_id, lamports,
-			      space);
-
-	return SUCCESS;
+	return system_create_account(ctx, account, ctx->payer, ctx->prog_id,
+				     lamports, space);
 }
@@ -33,4 +33,34 @@ static inline u64 spl_get_amount(const SolAccountInfo *acc, u64 *amount)
 	return SUCCESS;
 }
 
+// an initialized spl mint: 82 bytes, is_initialized at 45
+#define SPL_MINT_SIZE 82
+static inline bool spl_is_mint(const struct prog_ctx *ctx,
+			       const SolAccountInfo *acc)
+{
+	return pubkey_same(acc->owner, &ctx->progs.spl) &&
+	       acc->data_len == SPL_MINT_SIZE && acc->data[45] != 0;
+}
+
+/*
+  a token account of the token program whose owner (the authority, not
+  the program owning the account) is `owner`
+ */
+static inline bool spl_owner_is(const struct prog_ctx *ctx,
+				const SolAccountInfo *acc,
+				const SolPubkey *owner)
+{
+	if (!pubkey_same(acc->owner, &ctx->progs.spl)) {
+		mayan_error("not a token account");
+		return false;
+	}
+
+	if (acc->data_len < 72) {
+		mayan_error("spl account data problem");
+		return false;
+	}
+
+	return buf_pubkey_same(acc->data + 32, owner);
+}
+
 #endif // _SPL_H_
@@ -1,20 +1,5 @@
 #include "utils.h"
 
-// https://stackoverflow.com/a/101613
-u64 mpow(u64 base, u64 exp)
-{
-	u64 result = 1;
-	for(;;) {
-		if (exp & 1)
-			result *= base;
-		exp >>= 1;
-		if (!exp)
-			break;
-		base *= base;
-	}
-	return result;
-}
-
 void mayan_log_buf_32(const u8* buf)
 {
 	u64 x1, x2, x3, x4;
@@ -5,11 +5,15 @@
 #include "sol/pubkey.h"
 #include "sol/types.h"
 #include <solana_sdk.h>
+#include "build-info.h"
 
 #define _AS_STRING_EXPAND_MACRO(x) #x
 #define AS_STRING(x) _AS_STRING_EXPAND_MACRO(x)
 
+// release builds (`PROFILE=release ./build.sh`) ship without debug logs
+#ifndef BUILD_RELEASE
 #define DEBUG_FLAG
+#endif
 #define OVERFLOW_FLAG
 
 #define max(a, b)                                                              \
@@ -26,6 +30,11 @@
 		_a < _b ? _a : _b;                                             \
 	})
 
+/*
+  instruction handlers own their account arrays. kept out of `entrypoint`
+  so each array sits in its handler's frame, under the 4 KiB bpf frame.
+ */
+#define noinline __attribute__((noinline))
 
 typedef int64_t i64;
 typedef int32_t i32;
@@ -37,15 +46,29 @@ typedef uint32_t u32;
 typedef uint16_t u16;
 typedef uint8_t u8;
 
+#include "bytes.h"
+
 #define mayan_log_base(level, file, line, msg) sol_log(level "" file ":" AS_STRING(line) ": " msg)
+
+#ifdef DEBUG_FLAG
 #define mayan_error(msg) mayan_log_base("[ERROR] ", __FILE__, __LINE__, msg)
+#else
+/*
+   release errors are logged as numbers:
+   "error" tag, last 8 chars of the file name (little endian ascii), line
+ */
+#define MAYAN_ERROR_TAG 0x726f727265
+#define mayan_error(msg) sol_log_64(MAYAN_ERROR_TAG, mayan_file_tag(__FILE__, sizeof(__FILE__)), __LINE__, 0, 0)
+#endif // DEBUG_FLAG
 
 #ifdef DEBUG_FLAG
 #define mayan_debug(msg) sol_log(__FILE__ ":" AS_STRING(__LINE__) ": " msg)
 #define mayan_debug_64(u64_1, u64_2, u64_3, u64_4, u64_5) sol_log_64(u64_1, u64_2, u64_3, u64_4, u64_5)
+#define mayan_debug_buf_32(buf) mayan_log_buf_32(buf)
 #else
 #define mayan_debug(msg)
 #define mayan_debug_64(u64_1, u64_2, u64_3, u64_4, u64_5) 
+#define mayan_debug_buf_32(buf)
 #endif // DEBUG_FLAG
 
 #define mayan_assert(value, msg) if (!(value)) {\
@@ -62,6 +85,18 @@ typedef uint8_t u8;
 #endif
 
 
+// folded at compile time, `file` is always a literal
+static inline u64 mayan_file_tag(const char *file, u64 size)
+{
+	u64 tag = 0;
+	u64 i = (size > 9) ? size - 9 : 0;
+
+	for (int shift = 0; i < size - 1; ++i, shift += 8)
+		tag |= (u64)(u8)file[i] << shift;
+
+	return tag;
+}
+
 static inline void write_u8(u8 *data, u8 **data_ptr, u8 value)
 {
 	*(u8*)(*data_ptr) = value;
@@ -92,13 +127,15 @@ static inline void write_i64(u8 *data, u8 **data_ptr, i64 value)
 	(*data_ptr) += sizeof(i64);
 }
 
+// keys and hashes (32 bytes) as four words, the rest via the memcpy syscall
 static inline void write_buffer(u8 *data, u8 **data_ptr, const u8 *buf,
 				int size)
 {
-	for (int i = 0; i < size; ++i) {
-		write_u8(data, data_ptr, *buf);
-		buf++;
-	}
+	if (size == 32)
+		buf32_copy(*data_ptr, buf);
+	else
+		sol_memcpy(*data_ptr, buf, size);
+	(*data_ptr) += size;
 }
 
 static inline bool check_buffer_is_done(const u8 *data, const u8 *data_ptr, int size)
@@ -111,50 +148,6 @@ static inline bool check_buffer_is_ok(const u8 *data, const u8 *data_ptr, int si
 	return (data_ptr - data) <= size;
 }
 
-static inline u64 read_u64_be(const u8* data)
-{
-	u64 result = 0;
-	for (int i = 0; i < 8; ++i) {
-		result *= 256;
-		result += *data;
-		++data;
-	}
-	return result;
-}
-
-static inline u16 read_u16_be(const u8* data)
-{
-	u16 result = 0;
-	for (int i = 0; i < 2; ++i) {
-		result *= 256;
-		result += *data;
-		++data;
-	}
-	return result;
-}
-
-static inline void write_u16_be(u8 *buffer, u16 x)
-{
-	buffer += 1;
-
-	for (int i = 0; i < 2; ++i) {
-		*buffer = x % 256;
-		x /= 256;
-		buffer--;
-	}
-}
-
-static inline void write_u64_be(u8 *buffer, u64 x)
-{
-	buffer += 7;
-
-	for (int i = 0; i < 8; ++i) {
-		*buffer = x % 256;
-		x /= 256;
-		buffer--;
-	}
-}
-
 inline u8 spl_get_decimals(const SolAccountInfo *mint)
 {
 	if (mint->data_len < 45)
@@ -162,61 +155,9 @@ inline u8 spl_get_decimals(const SolAccountInfo *mint)
 	return mint->data[44];
 }
 
-// mayan power function
-u64 mpow(u64 base, u64 exp);
-
-/*
-   this is really bad.
-   TODO: maybe not inline?
- */
-inline u64 decimal_pow(u8 decimals)
-{
-	switch (decimals) {
-	case 0:
-		return (long)1e0;
-	case 1:
-		return (long)1e1;
-	case 2:
-		return (long)1e2;
-	case 3:
-		return (long)1e3;
-	case 4:
-		return (long)1e4;
-	case 5:
-		return (long)1e5;
-	case 6:
-		return (long)1e6;
-	case 7:
-		return (long)1e7;
-	case 8:
-		return (long)1e8;
-	case 9:
-		return (long)1e9;
-	default:
-		return mpow(10, decimals);
-	}
-}
-
-static inline bool buf_pubkey_same(const u8 *data, const SolPubkey *key)
-{
-	int i;
-	const u8 *ref;
-
-	ref = key->x;
-
-	for (i = 0; i < 32; ++i) {
-		if (*ref != *data)
-			return false;
-		ref++;
-		data++;
-	}
-
-	return true;
-}
-
 inline static u64 get_token_amount(const SolAccountInfo* info, u64* result)
 {
-	sol_log("get toekn amount");
+	mayan_debug("get token amount");
 	if (info->data_len < 64 + 8) {
 		return ERROR_ACCOUNT_DATA_TOO_SMALL;
 	}
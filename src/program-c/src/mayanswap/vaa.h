@@ -0,0 +1,118 @@
+#ifndef _VAA_H_
+#define _VAA_H_
+
+#include "sol/types.h"
+#include "layout.h"
+
+/*
+  the vaa pair of an order, decoded once: msg1 is the token bridge
+  transfer, msg2 the mayan swap. addresses point into the messages, the
+  numbers are decoded. mayan_vaa_decode only checks the sizes, the claim
+  checks (emitters, pair, claimed) read the view. plain buffers in, so
+  the host tools decode the same way.
+ */
+struct mayan_vaa_view {
+	// msg1
+	u16 chain;
+	u64 seq;
+	u8 payload1;
+	const u8 *emitter1;
+	const u8 *tkn_from;
+	u16 tkn_from_chain;
+
+	// msg2
+	u16 chain2;
+	u64 ref_seq;
+	u8 payload2;
+	const u8 *emitter2;
+	u64 amount;
+	const u8 *tkn_to;
+	u16 tkn_to_chain;
+	const u8 *to_addr;
+	u16 to_chain;
+	u64 fee_swap;
+	u64 fee_return;
+	const u8 *markets; // market1 then market2
+	u64 amount_min;
+	u64 deadline;
+
+	// single vaa orders: who redeems the transfer, on which chain
+	const u8 *redeemer;
+	u16 redeemer_chain;
+};
+
+static inline bool mayan_vaa_decode(struct mayan_vaa_view *v,
+				    const u8 *msg1, u64 msg1_len,
+				    const u8 *msg2, u64 msg2_len)
+{
+	if (msg1_len < VAA_TRANSFER_SIZE || msg2_len != VAA_MAYAN_SIZE)
+		return false;
+
+	v->chain = vaa_chain_id(msg1);
+	v->seq = vaa_seq_id(msg1);
+	v->payload1 = vaa_payload_id(msg1);
+	v->emitter1 = vaa_emitter_addr(msg1);
+	v->tkn_from = vaa_transfer_tkn_addr(msg1);
+	v->tkn_from_chain = vaa_transfer_chain_id(msg1);
+
+	v->chain2 = vaa_chain_id(msg2);
+	v->ref_seq = vaa_mayan_ref_seq_id(msg2);
+	v->payload2 = vaa_payload_id(msg2);
+	v->emitter2 = vaa_emitter_addr(msg2);
+	v->amount = vaa_mayan_amount(msg2);
+	v->tkn_to = vaa_mayan_tkn_addr(msg2);
+	v->tkn_to_chain = vaa_mayan_tkn_chain_id(msg2);
+	v->to_addr = vaa_mayan_to_addr(msg2);
+	v->to_chain = vaa_mayan_to_chain(msg2);
+	v->fee_swap = vaa_mayan_fee_swap(msg2);
+	v->fee_return = vaa_mayan_fee_return(msg2);
+	v->markets = vaa_mayan_market1(msg2);
+	v->amount_min = vaa_mayan_amount_min(msg2);
+	v->deadline = vaa_mayan_deadline(msg2);
+
+	v->redeemer = NULL;
+	v->redeemer_chain = 0;
+
+	return true;
+}
+
+/*
+  a single vaa order is a transfer with payload (3) of the mayan bridge.
+  it fills the view of a pair: msg2 is the same message, its sender is
+  the msg2 emitter and the amount is the one transferred.
+ */
+static inline bool mayan_vaa_decode_single(struct mayan_vaa_view *v,
+					   const u8 *msg, u64 msg_len)
+{
+	if (msg_len < VAA_SWAP3_SIZE)
+		return false;
+
+	v->chain = vaa_chain_id(msg);
+	v->seq = vaa_seq_id(msg);
+	v->payload1 = vaa_payload_id(msg);
+	v->emitter1 = vaa_emitter_addr(msg);
+	v->tkn_from = vaa_swap3_tkn_addr(msg);
+	v->tkn_from_chain = vaa_swap3_tkn_chain_id(msg);
+
+	v->chain2 = v->chain;
+	v->ref_seq = v->seq;
+	v->payload2 = v->payload1;
+	v->emitter2 = vaa_swap3_sender(msg);
+	v->amount = vaa_swap3_amount(msg);
+	v->tkn_to = vaa_swap3_tkn_to(msg);
+	v->tkn_to_chain = vaa_swap3_tkn_to_chain_id(msg);
+	v->to_addr = vaa_swap3_to_addr(msg);
+	v->to_chain = vaa_swap3_to_chain(msg);
+	v->fee_swap = vaa_swap3_fee_swap(msg);
+	v->fee_return = vaa_swap3_fee_return(msg);
+	v->markets = vaa_swap3_market1(msg);
+	v->amount_min = vaa_swap3_amount_min(msg);
+	v->deadline = vaa_swap3_deadline(msg);
+
+	v->redeemer = vaa_swap3_redeemer(msg);
+	v->redeemer_chain = vaa_swap3_redeemer_chain(msg);
+
+	return true;
+}
+
+#endif // _VAA_H_
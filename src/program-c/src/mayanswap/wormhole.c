@@ -1,80 +1,46 @@
 #include "wormhole.h"
+#include "chains.h"
+#include "cpi.h"
 #include "sol/pubkey.h"
 #include "sol/string.h"
 #include "sol/types.h"
 #include "utils.h"
 
-#define CHAIN_ID_SOLANA 1
-#define CHAIN_ID_BSC 4
-#define CHAIN_ID_POLYGON 5
-
-#define POLYGON_TOKEN_BRIDGE (SolPubkey){.x={0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 90, 88, 80, 90, 150, 209, 219, 248, 223, 145, 203, 33, 181, 68, 25, 252, 54, 233, 63, 222}}
-#define POLYGON_MAYAN_BRIDGE (SolPubkey){.x={0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 208, 248, 138, 236, 92, 77, 226, 12, 201, 112, 223, 209, 115, 86, 76, 177, 132, 37, 225, 238}}
-
-#define BSC_TOKEN_BRIDGE (SolPubkey){.x={0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 182, 246, 216, 106, 143, 152, 121, 169, 200, 127, 100, 55, 104, 217, 239, 195, 140, 29, 166, 231}}
-#define BSC_MAYAN_BRIDGE (SolPubkey){.x={0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 215, 147, 245, 20, 205, 227, 116, 67, 223, 200, 14, 57, 216, 228, 14, 147, 35, 166, 60, 171}}
-
 /*
   msg1 --> is token transfer msg
   msg2 --> is swap msg
  */
-u64 check_vaa_pair(const SolAccountInfo *msg1, const SolAccountInfo *msg2)
+u64 check_vaa_pair(const struct mayan_vaa_view *vaa)
 {
-	u64 seq1;
-	u64 seq2;
-	u16 chain_id1;
-	u16 chain_id2;
-
 	mayan_debug("check vaa pair!");
-	if (msg1->data_len < 96) {
-		mayan_error("msg1 data len");
-		return ERROR_ACCOUNT_DATA_TOO_SMALL;
-	}
-	if (msg2->data_len != 396) {
-		mayan_error("msg2 data len");
-		return ERROR_ACCOUNT_DATA_TOO_SMALL;
-	}
-
-	chain_id1 = vaa_chain_id(msg1->data);
-	chain_id2 = vaa_chain_id(msg2->data);
-
-	if (chain_id1 != chain_id2) {
+	if (vaa->chain != vaa->chain2) {
 		mayan_error("chain id error");
-		mayan_debug_64(chain_id1, chain_id2, 0, 0, 0);
+		mayan_debug_64(vaa->chain, vaa->chain2, 0, 0, 0);
 		return ERROR_INVALID_ACCOUNT_DATA;
 	}
 
-	seq1 = vaa_seq_id(msg1->data);
-	seq2 = vaa_mayan_ref_seq_id(msg2->data);
-
-	if (seq1 != seq2) {
+	if (vaa->seq != vaa->ref_seq) {
 		mayan_error("seq reference is not valid");
-		mayan_debug_64(seq1, seq2, 0, 0, 0);
+		mayan_debug_64(vaa->seq, vaa->ref_seq, 0, 0, 0);
 		return ERROR_INVALID_ACCOUNT_DATA;
 	}
 
 	return SUCCESS;
 }
 
-bool is_emitter_token_bridge(const u8 *vaa)
+bool is_emitter_token_bridge(const struct mayan_vaa_view *vaa)
 {
 	mayan_debug("is emitter token bridge?");
-	u16 chain_id;
-	SolPubkey bridge;
-
-	chain_id = vaa_chain_id(vaa);
+	const struct wh_chain *chain;
 
-	if (chain_id == CHAIN_ID_POLYGON) {
-		bridge = POLYGON_TOKEN_BRIDGE;
-	} else if (chain_id == CHAIN_ID_BSC) {
-		bridge = BSC_TOKEN_BRIDGE;
-	} else {
+	chain = wh_chain_get(vaa->chain);
+	if (chain == NULL) {
 		mayan_error("Unknown chain id");
-		mayan_debug_64(chain_id, 0, 0, 0, 0);
+		mayan_debug_64(vaa->chain, 0, 0, 0, 0);
 		return false;
 	}
 
-	if (!buf_pubkey_same(vaa_emitter_addr_buf(vaa), &bridge)) {
+	if (!buf32_same(vaa->emitter1, chain->token_bridge)) {
 		mayan_debug("emitter is not token bridge.");
 		return false;
 	}
@@ -82,25 +48,20 @@ bool is_emitter_token_bridge(const u8 *vaa)
 	return true;
 }
 
-bool is_emitter_mayan_bridge(const u8 *vaa)
+// msg2 is on the chain of msg1 (check_vaa_pair)
+bool is_emitter_mayan_bridge(const struct mayan_vaa_view *vaa)
 {
 	mayan_debug("is emitter mayan bridge?");
-	u16 chain_id;
-	SolPubkey bridge;
-
-	chain_id = vaa_chain_id(vaa);
+	const struct wh_chain *chain;
 
-	if (chain_id == CHAIN_ID_POLYGON) {
-		bridge = POLYGON_MAYAN_BRIDGE;
-	} else if (chain_id == CHAIN_ID_BSC) {
-		bridge = BSC_MAYAN_BRIDGE;
-	} else {
+	chain = wh_chain_get(vaa->chain2);
+	if (chain == NULL) {
 		mayan_error("Unknown chain id");
-		mayan_debug_64(chain_id, 0, 0, 0, 0);
+		mayan_debug_64(vaa->chain2, 0, 0, 0, 0);
 		return false;
 	}
 
-	if (!buf_pubkey_same(vaa_emitter_addr_buf(vaa), &bridge)) {
+	if (!buf32_same(vaa->emitter2, chain->mayan_bridge)) {
 		mayan_error("emitter is not mayan bridge!");
 		return false;
 	}
@@ -108,69 +69,54 @@ bool is_emitter_mayan_bridge(const u8 *vaa)
 	return true;
 }
 
-u64 wh_check_msg_addr(const struct prog_ctx *ctx, const SolPubkey *msg,
-		      u8 nonce, const u8 *hash)
+/*
+  only the core bridge writes the accounts it owns, and its posted vaas
+  start with "vaa" (its other accounts don't), so no address derivation
+ */
+u64 wh_check_posted_vaa(const struct prog_ctx *ctx, const SolAccountInfo *msg)
 {
-	SolPubkey addr;
-	u64 result;
-	const u8 seed[] = {'P', 'o', 's', 't', 'e', 'd', 'V', 'A', 'A'};
-	const SolSignerSeed seeds[] = {
-		{.addr=seed, .len=SOL_ARRAY_SIZE(seed)},
-		{.addr=hash, .len=32},
-		{.addr=&nonce, .len=1},
-	};
-
-	mayan_debug("wormhole check msg addr");
-
-	result = sol_create_program_address(seeds, SOL_ARRAY_SIZE(seeds),
-					    &ctx->progs.wh_core, &addr);
-
-	if (result != SUCCESS) {
-		mayan_error("cannot create prog addr");
-		mayan_debug_64(hash[0], hash[1], hash[2], hash[3], nonce);
-		return result;
+	if (!pubkey_same(msg->owner, &ctx->progs.wh_core)) {
+		mayan_error("msg is not wormhole's");
+		return ERROR_INCORRECT_PROGRAM_ID;
 	}
 
-	if (!SolPubkey_same(&addr, msg)) {
-		mayan_error("msg addr is wrong!");
-		mayan_debug_64(hash[0], hash[1], hash[2], hash[3], nonce);
-		return ERROR_CUSTOM_ZERO;
+	if (msg->data_len < VAA_HEADER_SIZE ||
+	    (vaa_prefix(msg->data) & VAA_POSTED_PREFIX_MASK) !=
+	    VAA_POSTED_PREFIX) {
+		mayan_error("msg is not a posted vaa");
+		return ERROR_INVALID_ACCOUNT_DATA;
 	}
 
 	return SUCCESS;
 }
 
-u64 wh_check_claimed(const struct prog_ctx *ctx, const SolAccountInfo *msg,
-                     u8 nonce, const SolAccountInfo *claim)
+u64 wh_check_claimed(const struct prog_ctx *ctx,
+		     const struct mayan_vaa_view *vaa, u8 nonce,
+		     const SolAccountInfo *claim)
 {
-	SolPubkey emitter;
+	const struct wh_chain *chain;
 	SolPubkey addr;
 	u8 buf[10] = {0};
 
-	u16 chain_id;
-	u64 seq_id;
+	u16 chain_id = vaa->chain;
+	u64 seq_id = vaa->seq;
 	u64 result;
 
-	const SolSignerSeed seeds[] = {
-		{.addr=(u8*)(&emitter), .len=32},
-		{.addr=buf, .len=SOL_ARRAY_SIZE(buf)},
-		{.addr=&nonce, .len=1},
-	};
-
 	mayan_debug("wormhole: check claimed");
-	chain_id = vaa_chain_id(msg->data);
-	seq_id = vaa_seq_id(msg->data);
 
-	if (chain_id == CHAIN_ID_POLYGON) {
-		emitter = POLYGON_TOKEN_BRIDGE;
-	} else if (chain_id == CHAIN_ID_BSC) {
-		emitter = BSC_TOKEN_BRIDGE;
-	} else {
+	chain = wh_chain_get(chain_id);
+	if (chain == NULL) {
 		mayan_error("Unknown chain id");
 		mayan_debug_64(chain_id, 0, 0, 0, 0);
-		return false;
+		return ERROR_INVALID_ACCOUNT_DATA;
 	}
 
+	const SolSignerSeed seeds[] = {
+		{.addr=chain->token_bridge, .len=32},
+		{.addr=buf, .len=SOL_ARRAY_SIZE(buf)},
+		{.addr=&nonce, .len=1},
+	};
+
 	write_u16_be(buf, chain_id);
 	write_u64_be(buf + 2, seq_id);
 
@@ -178,7 +124,7 @@ u64 wh_check_claimed(const struct prog_ctx *ctx, const SolAccountInfo *msg,
 	if (result != SUCCESS)
 		return result;
 
-	if (!SolPubkey_same(&addr, claim->key)) {
+	if (!pubkey_same(&addr, claim->key)) {
 		mayan_error("claim addr is wrong!");
 		mayan_debug_64(chain_id, seq_id, 0, 0, nonce);
 
@@ -215,7 +161,7 @@ u64 wh_get_mint(const struct prog_ctx *ctx, const u8 *buf, u16 chain_id,
 	mayan_debug("wormhole get mint");
 
 	if (chain_id == CHAIN_ID_SOLANA) {
-		sol_memcpy(result, buf, 32);
+		buf32_copy(result->x, buf);
 		return SUCCESS;
 	}
 
@@ -234,52 +180,96 @@ u64 wh_get_mint(const struct prog_ctx *ctx, const u8 *buf, u16 chain_id,
 	return SUCCESS;
 }
 
+// the canonical wrapped mint of a foreign token, no nonce to trust
+u64 wh_find_mint(const struct prog_ctx *ctx, const u8 *buf, u16 chain_id,
+		 SolPubkey *result)
+{
+	u8 buf_cid[2] = {0};
+	u8 bump;
+	const u8 seed[] = {'w', 'r', 'a', 'p', 'p', 'e', 'd'};
+	const SolSignerSeed seeds[] = {
+		{.addr=seed, .len=SOL_ARRAY_SIZE(seed)},
+		{.addr=buf_cid, .len=SOL_ARRAY_SIZE(buf_cid)},
+		{.addr=buf, .len=32},
+	};
+
+	write_u16_be(buf_cid, chain_id);
+
+	if (sol_try_find_program_address(seeds, SOL_ARRAY_SIZE(seeds),
+					 &ctx->progs.wh_bridge, result,
+					 &bump) != SUCCESS) {
+		mayan_error("cannot find prog addr for mint");
+		return ERROR_INVALID_ARGUMENT;
+	}
+
+	return SUCCESS;
+}
+
+#define WH_TRANSFER_NATIVE 5
+#define WH_TRANSFER_WRAPPED 4
+#define WH_COMPLETE_NATIVE_PAYLOAD 9
+#define WH_COMPLETE_WRAPPED_PAYLOAD 10
+
+// sysvars and programs of both transfers
+#define WH_TRANSFER_FIXED_METAS                                                \
+	CPI_FIXED(cpi_clock), CPI_FIXED(cpi_rent), CPI_FIXED(cpi_system),      \
+	CPI_FIXED(cpi_wh_core), CPI_FIXED(cpi_spl)
+
+/*
+  payer, config, from, mint, custody, authority signer, custody signer,
+  bridge config, message, emitter, sequence, fee collector
+ */
+static const SolAccountMeta wh_transfer_native_metas[] = {
+	CPI_WS, CPI_R, CPI_W, CPI_W, CPI_W, CPI_R, CPI_R, CPI_W, CPI_WS, CPI_R,
+	CPI_W, CPI_W,
+	WH_TRANSFER_FIXED_METAS,
+};
+
+/*
+  payer, config, from, from owner, mint, wrapped meta, authority signer,
+  bridge config, message, emitter, sequence, fee collector
+ */
+static const SolAccountMeta wh_transfer_wrapped_metas[] = {
+	CPI_WS, CPI_R, CPI_W, CPI_S, CPI_W, CPI_R, CPI_R, CPI_W, CPI_WS, CPI_R,
+	CPI_W, CPI_W,
+	WH_TRANSFER_FIXED_METAS,
+};
+
+// sets every byte of the data, no template
+static void wh_transfer_data(u8 *data, u8 tag,
+			     const struct wh_transfer_acc *transfer)
+{
+	wh_transfer_ix_set_tag(data, tag);
+	wh_transfer_ix_set_nonce(data, transfer->nonce);
+	wh_transfer_ix_set_amount(data, transfer->amount);
+	wh_transfer_ix_set_relayer_fee(data, transfer->relayer_fee);
+	wh_transfer_ix_set_address(data, transfer->address);
+	wh_transfer_ix_set_chain(data, transfer->chain);
+}
+
 u64 wh_transfer_native(struct prog_ctx *ctx, struct wh_transfer_acc *transfer)
 {
 	SolInstruction ix;
-	u8 data[55];
-	u8* data_ptr;
+	SolAccountMeta accounts[SOL_ARRAY_SIZE(wh_transfer_native_metas)];
+	u8 data[WH_TRANSFER_IX_SIZE];
 
 	mayan_debug("wormhole transfer native > accs");
-
-	SolAccountMeta accounts[] = {
-		{transfer->payer, true, true},
-		{transfer->config->key, false, false},
-		{transfer->acc->key, true, false},
-		{transfer->mint->key, true, false},
-		{transfer->custody->key, true, false},
-		{transfer->auth_signer->key, false, false},
-		{transfer->custody_signer->key, false, false},
-		{transfer->bridge_conf->key, true, false},
-		{transfer->new_msg->key, true, true},
-		{transfer->emitter->key, false, false},
-		{transfer->seq_key->key, true, false},
-		{transfer->fee_acc->key, true, false},
-
-		// sysvar
-		{&ctx->clock.key, false, false},
-		{&ctx->rent.key, false, false},
-
-		// programs
-		{&ctx->progs.system, false, false},
-		{&ctx->progs.wh_core, false, false},
-		{&ctx->progs.spl, false, false},
-	};
-
+	cpi_from_template(accounts, wh_transfer_native_metas);
+	accounts[0].pubkey = transfer->payer;
+	accounts[1].pubkey = transfer->config->key;
+	accounts[2].pubkey = transfer->acc->key;
+	accounts[3].pubkey = transfer->mint->key;
+	accounts[4].pubkey = transfer->custody->key;
+	accounts[5].pubkey = transfer->auth_signer->key;
+	accounts[6].pubkey = transfer->custody_signer->key;
+	accounts[7].pubkey = transfer->bridge_conf->key;
+	accounts[8].pubkey = transfer->new_msg->key;
+	accounts[9].pubkey = transfer->emitter->key;
+	accounts[10].pubkey = transfer->seq_key->key;
+	accounts[11].pubkey = transfer->fee_acc->key;
 
 	mayan_debug("wormhole transfer native > data");
-	data_ptr = data;
-	write_u8(data, &data_ptr, 5);
-	write_u32(data, &data_ptr, transfer->nonce);
-	write_u64(data, &data_ptr, transfer->amount);
-	write_u64(data, &data_ptr, transfer->relayer_fee);
-	write_buffer(data, &data_ptr, transfer->address, 32);
-	write_u16(data, &data_ptr, transfer->chain);
-
-	if (!check_buffer_is_done(data, data_ptr, SOL_ARRAY_SIZE(data))) {
-		mayan_error("data is not full!");
-		return ERROR_CUSTOM_ZERO;
-	}
+	wh_transfer_data(data, WH_TRANSFER_NATIVE, transfer);
 
 	mayan_debug("wormhole transfer native > ix");
 	ix.program_id = &(ctx->progs.wh_bridge);
@@ -288,62 +278,93 @@ u64 wh_transfer_native(struct prog_ctx *ctx, struct wh_transfer_acc *transfer)
 	ix.data = data;
 	ix.data_len = SOL_ARRAY_SIZE(data);
 
-	return mayan_invoke(ctx, &ix);
+	return mayan_invoke(ctx, &ix, SIGN_NONE);
 }
 
 u64 wh_transfer_wrapped(struct prog_ctx *ctx, struct wh_transfer_acc *transfer)
 {
 	SolInstruction ix;
-	u8 data[55];
-	u8* data_ptr;
+	SolAccountMeta accounts[SOL_ARRAY_SIZE(wh_transfer_wrapped_metas)];
+	u8 data[WH_TRANSFER_IX_SIZE];
 
 	mayan_debug("wormhole transfer wrapped > accs");
+	cpi_from_template(accounts, wh_transfer_wrapped_metas);
+	accounts[0].pubkey = transfer->payer;
+	accounts[1].pubkey = transfer->config->key;
+	accounts[2].pubkey = transfer->acc->key;
+	accounts[3].pubkey = transfer->owner;
+	accounts[4].pubkey = transfer->mint->key;
+	accounts[5].pubkey = transfer->meta->key;
+	accounts[6].pubkey = transfer->auth_signer->key;
+	accounts[7].pubkey = transfer->bridge_conf->key;
+	accounts[8].pubkey = transfer->new_msg->key;
+	accounts[9].pubkey = transfer->emitter->key;
+	accounts[10].pubkey = transfer->seq_key->key;
+	accounts[11].pubkey = transfer->fee_acc->key;
 
-	SolAccountMeta accounts[] = {
-		{transfer->payer, true, true},
-		{transfer->config->key, false, false},
-		{transfer->acc->key, true, false},
-		{transfer->owner, false, true},
-		{transfer->mint->key, true, false},
-		{transfer->meta->key, false, false},
-		{transfer->auth_signer->key, false, false},
-		{transfer->bridge_conf->key, true, false},
-		{transfer->new_msg->key, true, true},
-		{transfer->emitter->key, false, false},
-		{transfer->seq_key->key, true, false},
-		{transfer->fee_acc->key, true, false},
-
-		// sysvar
-		{&ctx->clock.key, false, false},
-		{&ctx->rent.key, false, false},
-
-		// programs
-		{&ctx->progs.system, false, false},
-		{&ctx->progs.wh_core, false, false},
-		{&ctx->progs.spl, false, false},
-	};
+	mayan_debug("wormhole transfer wrapped > data");
+	wh_transfer_data(data, WH_TRANSFER_WRAPPED, transfer);
 
+	mayan_debug("wormhole transfer wrapped > ix");
+	ix.program_id = &(ctx->progs.wh_bridge);
+	ix.accounts = accounts;
+	ix.account_len = SOL_ARRAY_SIZE(accounts);
+	ix.data = data;
+	ix.data_len = SOL_ARRAY_SIZE(data);
 
-	mayan_debug("wormhole transfer wrapped > data");
-	data_ptr = data;
-	write_u8(data, &data_ptr, 4);
-	write_u32(data, &data_ptr, transfer->nonce);
-	write_u64(data, &data_ptr, transfer->amount);
-	write_u64(data, &data_ptr, transfer->relayer_fee);
-	write_buffer(data, &data_ptr, transfer->address, 32);
-	write_u16(data, &data_ptr, transfer->chain);
-
-	if (!check_buffer_is_done(data, data_ptr, SOL_ARRAY_SIZE(data))) {
-		mayan_error("data is not full!");
-		return ERROR_CUSTOM_ZERO;
+	return mayan_invoke(ctx, &ix, SIGN_MAIN);
+}
+
+// sysvars and programs of both redeems
+#define WH_REDEEM_FIXED_METAS                                                  \
+	CPI_FIXED(cpi_rent), CPI_FIXED(cpi_system), CPI_FIXED(cpi_wh_core),    \
+	CPI_FIXED(cpi_spl)
+
+/*
+  payer, config, message, claim, endpoint, to, to owner, fee recipient
+  (`to`, no relayer fee), then wrapped: mint, meta, mint authority;
+  native: custody, mint, custody signer. both have the same flags.
+ */
+static const SolAccountMeta wh_redeem_metas[] = {
+	CPI_WS, CPI_R, CPI_R, CPI_W, CPI_R, CPI_W, CPI_S, CPI_W, CPI_W, CPI_R,
+	CPI_R,
+	WH_REDEEM_FIXED_METAS,
+};
+
+u64 wh_redeem(struct prog_ctx *ctx, const struct wh_redeem_acc *redeem)
+{
+	SolInstruction ix;
+	SolAccountMeta accounts[SOL_ARRAY_SIZE(wh_redeem_metas)];
+	u8 data[1];
+
+	mayan_debug("wormhole redeem > accs");
+	cpi_from_template(accounts, wh_redeem_metas);
+	accounts[0].pubkey = redeem->payer;
+	accounts[1].pubkey = redeem->config->key;
+	accounts[2].pubkey = redeem->msg->key;
+	accounts[3].pubkey = redeem->claim->key;
+	accounts[4].pubkey = redeem->endpoint->key;
+	accounts[5].pubkey = redeem->to->key;
+	accounts[6].pubkey = redeem->owner;
+	accounts[7].pubkey = redeem->to->key;
+	accounts[10].pubkey = redeem->authority->key;
+
+	if (redeem->wrapped) {
+		accounts[8].pubkey = redeem->mint->key;
+		accounts[9].pubkey = redeem->meta->key;
+		data[0] = WH_COMPLETE_WRAPPED_PAYLOAD;
+	} else {
+		accounts[8].pubkey = redeem->meta->key;
+		accounts[9].pubkey = redeem->mint->key;
+		data[0] = WH_COMPLETE_NATIVE_PAYLOAD;
 	}
 
-	mayan_debug("wormhole transfer wrapped > ix");
+	mayan_debug("wormhole redeem > ix");
 	ix.program_id = &(ctx->progs.wh_bridge);
 	ix.accounts = accounts;
 	ix.account_len = SOL_ARRAY_SIZE(accounts);
 	ix.data = data;
 	ix.data_len = SOL_ARRAY_SIZE(data);
 
-	return mayan_invoke(ctx, &ix);
+	return mayan_invoke(ctx, &ix, SIGN_MAIN);
 }
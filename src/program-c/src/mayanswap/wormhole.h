@@ -6,88 +6,22 @@
 #include "sol/entrypoint.h"
 #include "sol/pubkey.h"
 #include "ctx.h"
+#include "layout.h"
+#include "vaa.h"
 
-static inline u16 vaa_chain_id(const u8 *data) { return *(u16 *)(&data[57]); }
-static inline u64 vaa_seq_id(const u8 *data) { return *(u64 *)(&data[49]); }
-static inline const u8* vaa_emitter_addr_buf(const u8 *data)
-{
-	return data + 59;
-}
-
-// first u8 after vaa header (valid for non empty payloads)
-static inline u8 vaa_payload_id(const u8 *data) { return *(u8 *)(&data[95]); }
-
-// transfer specific vaa
-static inline u8* vaa_transfer_tkn_addr(u8 *data) { return data + 128; }
-static inline u16 vaa_transfer_chain_id(const u8 *data)
-{
-	return read_u16_be(data + 160);
-}
-
-// mayan specific vaa
-static inline u8 *vaa_mayan_tkn_addr(u8 *data) { return data + 128; }
-static inline u16 vaa_mayan_tkn_chain_id(const u8 *data)
-{
-	return read_u16_be(data + 160);
-}
-static inline const u8 *vaa_mayan_market1(const u8 *data)
-{
-	return data + 260;
-}
-
-static inline const u8 *vaa_mayan_market2(const u8 *data)
-{
-	return data + 292;
-}
-
-static inline u64 vaa_mayan_amount(u8 *data)
-{
-	return read_u64_be(data + 96 + 32 - 8);
-}
-static inline u64 vaa_mayan_amount_min(u8 *data)
-{
-	return read_u64_be(data + 324 + 32 - 8);
-}
-static inline const u8 *vaa_mayan_to_addr_buf(const u8 *data)
-{
-	return data + 162;
-}
-static inline u16 vaa_mayan_to_chain(const u8 *data)
-{
-	return read_u16_be(data + 194);
-}
-
-static inline u64 vaa_mayan_ref_seq_id(u8 *data)
-{
-	return read_u64_be(data + 356);
-}
-
-static inline u64 vaa_mayan_fee_swap(const u8 *data)
-{
-	return read_u64_be(data + 196 + 32 - 8);
-}
-
-static inline u64 vaa_mayan_fee_return(const u8 *data)
-{
-	return read_u64_be(data + 228 + 32 - 8);
-}
-
-static inline u64 vaa_mayan_deadline(const u8 *data)
-{
-	return read_u64_be(data + 364 + 32 - 8);
-}
+u64 check_vaa_pair(const struct mayan_vaa_view *vaa);
+u64 wh_check_posted_vaa(const struct prog_ctx *ctx, const SolAccountInfo *msg);
+u64 wh_check_claimed(const struct prog_ctx *ctx,
+		     const struct mayan_vaa_view *vaa, u8 nonce,
+		     const SolAccountInfo *claim);
 
-u64 check_vaa_pair(const SolAccountInfo *msg1, const SolAccountInfo *msg2);
-u64 wh_check_msg_addr(const struct prog_ctx *ctx, const SolPubkey *msg,
-		      u8 nonce, const u8 *hash);
-u64 wh_check_claimed(const struct prog_ctx *ctx, const SolAccountInfo *msg,
-                     u8 nonce, const SolAccountInfo *claim);
-
-bool is_emitter_token_bridge(const u8 *vaa);
-bool is_emitter_mayan_bridge(const u8 *vaa);
+bool is_emitter_token_bridge(const struct mayan_vaa_view *vaa);
+bool is_emitter_mayan_bridge(const struct mayan_vaa_view *vaa);
 
 u64 wh_get_mint(const struct prog_ctx *ctx, const u8 *buf, u16 chain_id,
 		u8 nonce, SolPubkey *result);
+u64 wh_find_mint(const struct prog_ctx *ctx, const u8 *buf, u16 chain_id,
+		 SolPubkey *result);
 
 
 struct wh_transfer_acc {
@@ -123,19 +57,19 @@ struct wh_transfer_acc {
 static inline u64 parse_wh_trn_accounts(struct prog_ctx *ctx,
 					struct wh_transfer_acc *transfer)
 {
-	transfer->config = ctx->cursor++;
-	transfer->auth_signer = ctx->cursor++;
-	transfer->custody_signer = ctx->cursor++;
-	transfer->emitter = ctx->cursor++;
-	transfer->bridge_conf = ctx->cursor++;
-	transfer->seq_key = ctx->cursor++;
-	transfer->fee_acc = ctx->cursor++;
+	transfer->config = ctx_next_account(ctx);
+	transfer->auth_signer = ctx_next_account(ctx);
+	transfer->custody_signer = ctx_next_account(ctx);
+	transfer->emitter = ctx_next_account(ctx);
+	transfer->bridge_conf = ctx_next_account(ctx);
+	transfer->seq_key = ctx_next_account(ctx);
+	transfer->fee_acc = ctx_next_account(ctx);
 	// mint dependent
-	transfer->mint = ctx->cursor++;
-	transfer->custody = ctx->cursor++;
+	transfer->mint = ctx_next_account(ctx);
+	transfer->custody = ctx_next_account(ctx);
 	// transfer dependent
-	transfer->acc = ctx->cursor++;
-	transfer->new_msg = ctx->cursor++;
+	transfer->acc = ctx_next_account(ctx);
+	transfer->new_msg = ctx_next_account(ctx);
 
 	transfer->nonce = *(u32 *)ctx->data_ptr;
 	ctx->data_ptr += 4;
@@ -151,18 +85,18 @@ static inline u64 parse_wh_trw_accounts(struct prog_ctx *ctx,
 					struct wh_transfer_acc *transfer)
 {
 	// wormhole static
-	transfer->config = ctx->cursor++;
-	transfer->auth_signer = ctx->cursor++;
-	transfer->emitter = ctx->cursor++;
-	transfer->bridge_conf = ctx->cursor++;
-	transfer->seq_key = ctx->cursor++;
-	transfer->fee_acc = ctx->cursor++;
+	transfer->config = ctx_next_account(ctx);
+	transfer->auth_signer = ctx_next_account(ctx);
+	transfer->emitter = ctx_next_account(ctx);
+	transfer->bridge_conf = ctx_next_account(ctx);
+	transfer->seq_key = ctx_next_account(ctx);
+	transfer->fee_acc = ctx_next_account(ctx);
 	// mint dependent
-	transfer->mint = ctx->cursor++;
-	transfer->meta = ctx->cursor++;
+	transfer->mint = ctx_next_account(ctx);
+	transfer->meta = ctx_next_account(ctx);
 	// transfer dependent
-	transfer->acc = ctx->cursor++;
-	transfer->new_msg = ctx->cursor++;
+	transfer->acc = ctx_next_account(ctx);
+	transfer->new_msg = ctx_next_account(ctx);
 
 	transfer->nonce = *(u32 *)ctx->data_ptr;
 	ctx->data_ptr += 4;
@@ -174,6 +108,40 @@ static inline u64 parse_wh_trw_accounts(struct prog_ctx *ctx,
 
 u64 wh_transfer_wrapped(struct prog_ctx *ctx, struct wh_transfer_acc *transfer);
 
+/*
+  redeems a transfer with payload to MAIN, the redeemer of the transfer.
+  the token bridge checks the message, the claim, the mint and that `to`
+  is MAIN's, and creates the claim.
+ */
+struct wh_redeem_acc {
+	SolAccountInfo *config;
+	SolAccountInfo *msg;
+	SolAccountInfo *claim;
+	SolAccountInfo *endpoint;
+	SolAccountInfo *to;
+	SolAccountInfo *mint;
+	SolAccountInfo *meta; // wrapped meta, native custody
+	SolAccountInfo *authority; // wrapped mint authority, native custody signer
+
+	SolPubkey *owner; // MAIN
+	SolPubkey *payer;
+
+	bool wrapped;
+};
+
+static inline void parse_wh_redeem_accounts(struct prog_ctx *ctx,
+					    struct wh_redeem_acc *redeem)
+{
+	redeem->config = ctx_next_account(ctx);
+	redeem->claim = ctx_next_account(ctx);
+	redeem->endpoint = ctx_next_account(ctx);
+	redeem->to = ctx_next_account(ctx);
+	redeem->meta = ctx_next_account(ctx);
+	redeem->authority = ctx_next_account(ctx);
+}
+
+u64 wh_redeem(struct prog_ctx *ctx, const struct wh_redeem_acc *redeem);
+
 static inline u64 wh_seq_id(const SolAccountInfo *acc, u64 *seq_id)
 {
 	if (acc->data_len != 8) {
@@ -185,4 +153,25 @@ static inline u64 wh_seq_id(const SolAccountInfo *acc, u64 *seq_id)
 	return SUCCESS;
 }
 
+/*
+  message fee of the core bridge config: guardian set index u32, last
+  lamports u64, guardian set expiration u32, fee u64
+ */
+static inline u64 wh_message_fee(const struct prog_ctx *ctx,
+				  const SolAccountInfo *bridge_conf, u64 *fee)
+{
+	if (!pubkey_same(bridge_conf->owner, &ctx->progs.wh_core)) {
+		mayan_error("bridge config is not wormhole's");
+		return ERROR_INCORRECT_PROGRAM_ID;
+	}
+
+	if (bridge_conf->data_len < 24) {
+		mayan_error("cannot read message fee");
+		return ERROR_ACCOUNT_DATA_TOO_SMALL;
+	}
+
+	*fee = *(u64 *)(bridge_conf->data + 16);
+	return SUCCESS;
+}
+
 #endif // _WORMHOLE_H_